@@ -0,0 +1,599 @@
+#include "../timing.h"
+#include <algorithm>
+#include <cheriot-atomic.hh>
+#include <compartment.h>
+#include <debug.hh>
+#include <ds/xoroshiro.h>
+#include <stdlib.h>
+#include <thread.h>
+
+using Debug = ConditionalDebug<DEBUG_ALLOCSUITE, "Allocator benchmark suite">;
+
+/**
+ * The quota used for the near-full-quota scenario.
+ */
+#define NEAR_FULL_QUOTA 4096
+DECLARE_AND_DEFINE_ALLOCATOR_CAPABILITY(nearFullQuota, NEAR_FULL_QUOTA);
+#define NEAR_FULL_HEAP STATIC_SEALED_VALUE(nearFullQuota)
+
+namespace
+{
+	/**
+	 * Number of objects that are live at once in the free-order scenario.
+	 */
+	constexpr size_t Objects = 64;
+
+	/**
+	 * Number of times to repeat each free-order and near-full-quota run.
+	 */
+	constexpr size_t Rounds = 8;
+
+	/**
+	 * The largest size that either distribution produces.
+	 */
+	constexpr size_t MaxSize = 1024;
+
+	/**
+	 * Number of objects kept live in the steady-state revocation scenario.
+	 */
+	constexpr size_t ChurnLive = 32;
+
+	/**
+	 * Number of objects replaced in the steady-state revocation scenario.
+	 * This is enough to allocate the whole heap several times over, so the
+	 * revoker is running for most of the scenario.
+	 */
+	constexpr size_t ChurnOperations = 4096;
+
+	/**
+	 * Number of objects kept live by each thread in the contention scenario.
+	 */
+	constexpr size_t WorkerLive = 16;
+
+	/**
+	 * Number of objects replaced by each thread in the contention scenario.
+	 */
+	constexpr size_t WorkerOperations = 512;
+
+	/**
+	 * Each thread in the contention scenario sleeps for a tick after this
+	 * many operations, so that lower-priority threads run and are preempted
+	 * part-way through their own allocator calls.
+	 */
+	constexpr size_t WorkerYieldInterval = 16;
+
+	/**
+	 * Number of threads that take part in the contention scenario: `run`, at
+	 * priority 1, and the two workers.
+	 */
+	constexpr size_t ContentionThreads = 3;
+
+	/**
+	 * Timeout for allocations in the scenarios that may need to wait for
+	 * revocation.
+	 */
+	constexpr Ticks AllocTimeout = 10;
+
+	/**
+	 * The size distributions that the scenarios draw from.
+	 */
+	enum class Distribution
+	{
+		/**
+		 * Each power-of-two size class, starting at 16 bytes, is half as
+		 * likely as the one before it, so the probability of a size is
+		 * roughly inversely proportional to the size.
+		 */
+		PowerLaw,
+		/**
+		 * 80% small objects (16-64 bytes) and 20% large buffers (512-1024
+		 * bytes).
+		 */
+		Bimodal,
+	};
+
+	/**
+	 * The order in which the free-order scenario frees its objects.
+	 */
+	enum class FreeOrder
+	{
+		/// Most recently allocated first.
+		LIFO,
+		/// Least recently allocated first.
+		FIFO,
+		/// A random permutation.
+		Random,
+	};
+
+	const char *distribution_name(Distribution distribution)
+	{
+		return (distribution == Distribution::PowerLaw) ? "power-law"
+		                                                : "bimodal";
+	}
+
+	const char *order_name(FreeOrder order)
+	{
+		switch (order)
+		{
+			case FreeOrder::LIFO:
+				return "lifo";
+			case FreeOrder::FIFO:
+				return "fifo";
+			case FreeOrder::Random:
+				return "random";
+		}
+		return "-";
+	}
+
+	using Random = ds::xoroshiro::P64R32;
+
+	/**
+	 * Return a size drawn from `distribution`.
+	 */
+	size_t size_sample(Distribution distribution, Random &rand)
+	{
+		uint32_t r = rand();
+		if (distribution == Distribution::PowerLaw)
+		{
+			size_t base = 16;
+			while ((base < MaxSize / 2) && (r & 1))
+			{
+				base <<= 1;
+				r >>= 1;
+			}
+			return base + ((r >> 1) % base);
+		}
+		if ((r % 5) != 0)
+		{
+			return 16 + ((r >> 8) % 49);
+		}
+		return 512 + ((r >> 8) % (MaxSize - 512 + 1));
+	}
+
+	/**
+	 * Counts of operations, and of the cycles and instructions that they
+	 * took.  The instruction counter is global, so instructions retired by
+	 * other threads that preempt an operation are counted against it.
+	 */
+	struct Counters
+	{
+		size_t   operations   = 0;
+		size_t   failures     = 0;
+		uint64_t cycles       = 0;
+		uint64_t instructions = 0;
+
+		/**
+		 * Run `operation`, which returns whether it succeeded, and add its
+		 * cost to the counters.
+		 */
+		template<typename Operation>
+		bool measure(Operation &&operation)
+		{
+			auto startCycles       = rdcycle();
+			auto startInstructions = rdinstret();
+			bool succeeded         = operation();
+			auto endInstructions   = rdinstret();
+			auto endCycles         = rdcycle();
+			cycles += static_cast<uint32_t>(endCycles - startCycles);
+			instructions +=
+			  static_cast<uint32_t>(endInstructions - startInstructions);
+			operations++;
+			failures += !succeeded;
+			return succeeded;
+		}
+	};
+
+	/**
+	 * Return the number of revocation passes that have completed.
+	 */
+	uint32_t revocation_epochs()
+	{
+		HeapStats stats;
+		Debug::Invariant(heap_stats(MALLOC_CAPABILITY, &stats) == 0,
+		                 "heap_stats failed");
+		return stats.revocationEpochs;
+	}
+
+	/**
+	 * Print one row of results.
+	 */
+	void report(const char     *scenario,
+	            const char     *distribution,
+	            const char     *order,
+	            int             priority,
+	            const char     *operation,
+	            const Counters &counters,
+	            uint32_t        revocations)
+	{
+		size_t operations = std::max<size_t>(counters.operations, 1);
+		printf(__XSTRING(BOARD) ",%s,%s,%s,%d,%s,%zu,%zu,%u,%u,%u\n",
+		       scenario,
+		       distribution,
+		       order,
+		       priority,
+		       operation,
+		       counters.operations,
+		       counters.failures,
+		       static_cast<uint32_t>(counters.cycles / operations),
+		       static_cast<uint32_t>(counters.instructions / operations),
+		       revocations);
+	}
+
+	/**
+	 * Allocate `size` bytes from `heap` into `slot`, recording the cost in
+	 * `counters`.
+	 */
+	void allocate_into(Counters           &counters,
+	                   AllocatorCapability heap,
+	                   void              *&slot,
+	                   size_t              size,
+	                   Ticks               timeout)
+	{
+		counters.measure([&]() {
+			Timeout t{timeout};
+			slot = heap_allocate(&t, heap, size);
+			return __builtin_cheri_tag_get(slot);
+		});
+		if (!__builtin_cheri_tag_get(slot))
+		{
+			slot = nullptr;
+		}
+	}
+
+	/**
+	 * Free `slot` to `heap`, if it holds an object, recording the cost in
+	 * `counters`.
+	 */
+	void free_from(Counters &counters, AllocatorCapability heap, void *&slot)
+	{
+		if (slot == nullptr)
+		{
+			return;
+		}
+		counters.measure([&]() { return heap_free(heap, slot) == 0; });
+		slot = nullptr;
+	}
+
+	/**
+	 * Objects live in the free-order and near-full-quota scenarios.
+	 */
+	void *objects[Objects];
+
+	/**
+	 * The order in which to free `objects`.
+	 */
+	size_t freeOrder[Objects];
+
+	/**
+	 * Allocate `Objects` objects with sizes drawn from `distribution` and free
+	 * them in `order`, `Rounds` times, reporting the cost of each allocation
+	 * and free.
+	 */
+	void run_free_order(Distribution distribution, FreeOrder order)
+	{
+		Random   rand;
+		Counters allocations;
+		Counters frees;
+		uint32_t startEpoch = revocation_epochs();
+		for (size_t round = 0; round < Rounds; round++)
+		{
+			for (auto &object : objects)
+			{
+				allocate_into(allocations,
+				              MALLOC_CAPABILITY,
+				              object,
+				              size_sample(distribution, rand),
+				              AllocTimeout);
+			}
+			for (size_t i = 0; i < Objects; i++)
+			{
+				freeOrder[i] = (order == FreeOrder::LIFO) ? Objects - 1 - i : i;
+			}
+			if (order == FreeOrder::Random)
+			{
+				for (size_t i = Objects - 1; i > 0; i--)
+				{
+					std::swap(freeOrder[i], freeOrder[rand() % (i + 1)]);
+				}
+			}
+			for (size_t i : freeOrder)
+			{
+				free_from(frees, MALLOC_CAPABILITY, objects[i]);
+			}
+			// Start each round with an empty quarantine, so that rounds are
+			// comparable.
+			Debug::Invariant(heap_quarantine_empty() == 0,
+			                 "Call to heap_quarantine_empty failed");
+		}
+		uint32_t revocations = revocation_epochs() - startEpoch;
+		report("free-order",
+		       distribution_name(distribution),
+		       order_name(order),
+		       1,
+		       "allocate",
+		       allocations,
+		       revocations);
+		report("free-order",
+		       distribution_name(distribution),
+		       order_name(order),
+		       1,
+		       "free",
+		       frees,
+		       revocations);
+	}
+
+	/**
+	 * Fill an allocator capability until less than 256 bytes of its quota
+	 * remain and then allocate and immediately free objects with sizes drawn
+	 * from `distribution`.  Allocations that do not fit in the remaining
+	 * quota are reported as failures, without waiting for quota to be freed.
+	 */
+	void run_near_full_quota(Distribution distribution)
+	{
+		Random   rand;
+		Counters allocations;
+		Counters frees;
+		Counters unused;
+		size_t   filled = 0;
+		while ((filled < Objects) &&
+		       (heap_quota_remaining(NEAR_FULL_HEAP) >= 256 + 64 + 8))
+		{
+			allocate_into(unused, NEAR_FULL_HEAP, objects[filled++], 64, 0);
+		}
+		uint32_t startEpoch = revocation_epochs();
+		for (size_t i = 0; i < Rounds * Objects; i++)
+		{
+			void *object;
+			allocate_into(allocations,
+			              NEAR_FULL_HEAP,
+			              object,
+			              size_sample(distribution, rand),
+			              0);
+			free_from(frees, NEAR_FULL_HEAP, object);
+		}
+		uint32_t revocations = revocation_epochs() - startEpoch;
+		for (size_t i = 0; i < filled; i++)
+		{
+			free_from(unused, NEAR_FULL_HEAP, objects[i]);
+		}
+		Debug::Invariant(heap_quarantine_empty() == 0,
+		                 "Call to heap_quarantine_empty failed");
+		report("near-full-quota",
+		       distribution_name(distribution),
+		       "-",
+		       1,
+		       "allocate",
+		       allocations,
+		       revocations);
+		report("near-full-quota",
+		       distribution_name(distribution),
+		       "-",
+		       1,
+		       "free",
+		       frees,
+		       revocations);
+	}
+
+	/**
+	 * Keep `live` objects allocated and replace a randomly chosen one
+	 * `operations` times, with sizes drawn from `distribution`.  The freed
+	 * objects are not drained from quarantine, so once the heap has been
+	 * allocated once the allocator must keep revoking to make progress.
+	 * When `yieldInterval` is non-zero, sleep for a tick after that many
+	 * replacements.
+	 */
+	void churn(Distribution distribution,
+	           Random      &rand,
+	           void       **live,
+	           size_t       liveCount,
+	           size_t       operations,
+	           size_t       yieldInterval,
+	           Counters    &allocations,
+	           Counters    &frees)
+	{
+		for (size_t i = 0; i < liveCount; i++)
+		{
+			allocate_into(allocations,
+			              MALLOC_CAPABILITY,
+			              live[i],
+			              size_sample(distribution, rand),
+			              AllocTimeout);
+		}
+		for (size_t i = 0; i < operations; i++)
+		{
+			void *&slot = live[rand() % liveCount];
+			free_from(frees, MALLOC_CAPABILITY, slot);
+			allocate_into(allocations,
+			              MALLOC_CAPABILITY,
+			              slot,
+			              size_sample(distribution, rand),
+			              AllocTimeout);
+			if ((yieldInterval != 0) && (((i + 1) % yieldInterval) == 0))
+			{
+				Timeout t{1};
+				thread_sleep(&t, ThreadSleepNoEarlyWake);
+			}
+		}
+		for (size_t i = 0; i < liveCount; i++)
+		{
+			free_from(frees, MALLOC_CAPABILITY, live[i]);
+		}
+	}
+
+	/**
+	 * Measure allocation and free in a steady state where the revoker is
+	 * running continuously.
+	 */
+	void run_revocation(Distribution distribution)
+	{
+		Random   rand;
+		Counters allocations;
+		Counters frees;
+		uint32_t startEpoch = revocation_epochs();
+		churn(distribution,
+		      rand,
+		      objects,
+		      ChurnLive,
+		      ChurnOperations,
+		      0,
+		      allocations,
+		      frees);
+		uint32_t revocations = revocation_epochs() - startEpoch;
+		Debug::Invariant(heap_quarantine_empty() == 0,
+		                 "Call to heap_quarantine_empty failed");
+		report("revocation",
+		       distribution_name(distribution),
+		       "random",
+		       1,
+		       "allocate",
+		       allocations,
+		       revocations);
+		report("revocation",
+		       distribution_name(distribution),
+		       "random",
+		       1,
+		       "free",
+		       frees,
+		       revocations);
+	}
+
+	/**
+	 * Set to 1 by `run` to start the contention scenario.
+	 */
+	cheriot::atomic<uint32_t> contentionStart;
+
+	/**
+	 * The number of threads that have finished the contention scenario.
+	 */
+	cheriot::atomic<uint32_t> contentionFinished;
+
+	/**
+	 * Results of the contention scenario, indexed by priority - 1.
+	 */
+	Counters contentionAllocations[ContentionThreads];
+	Counters contentionFrees[ContentionThreads];
+
+	/**
+	 * Wait for `counter` to reach `value`.
+	 */
+	void wait_for(cheriot::atomic<uint32_t> &counter, uint32_t value)
+	{
+		uint32_t current;
+		while ((current = counter.load()) != value)
+		{
+			counter.wait(current);
+		}
+	}
+
+	/**
+	 * Run this thread's part of the contention scenario.  Each thread uses a
+	 * different seed, so that they do not allocate the same sequence of
+	 * sizes.
+	 */
+	void contend(int priority)
+	{
+		void  *live[WorkerLive] = {};
+		Random rand(5489 + priority);
+		churn(Distribution::PowerLaw,
+		      rand,
+		      live,
+		      WorkerLive,
+		      WorkerOperations,
+		      WorkerYieldInterval,
+		      contentionAllocations[priority - 1],
+		      contentionFrees[priority - 1]);
+		contentionFinished++;
+		contentionFinished.notify_all();
+	}
+
+	/**
+	 * Entry point for the worker threads.
+	 */
+	int worker(int priority)
+	{
+		wait_for(contentionStart, 1);
+		contend(priority);
+		return 0;
+	}
+} // namespace
+
+/**
+ * Contention worker at priority 2.
+ */
+int __cheri_compartment("allocsuite") worker_medium()
+{
+	return worker(2);
+}
+
+/**
+ * Contention worker at priority 3.
+ */
+int __cheri_compartment("allocsuite") worker_high()
+{
+	return worker(3);
+}
+
+/**
+ * Run each scenario and report the cycles and instructions per operation as
+ * CSV.  Each row gives the scenario, the size distribution, the free order,
+ * the priority of the thread, the operation, the number of operations and of
+ * failed operations, the mean cycles and instructions per operation, and the
+ * number of revocation passes that completed during the scenario.
+ */
+int __cheri_compartment("allocsuite") run()
+{
+	const ptraddr_t HeapStart = LA_ABS(__export_mem_heap);
+	const ptraddr_t HeapEnd   = LA_ABS(__export_mem_heap_end);
+
+	const size_t HeapSize = HeapEnd - HeapStart;
+
+	// Make sure sail doesn't print annoying log messages in the middle of the
+	// output the first time that allocation happens.
+	free(malloc(16));
+
+	Debug::Invariant(heap_quarantine_empty() == 0,
+	                 "Call to heap_quarantine_empty failed");
+
+	printf("board,scenario,distribution,order,priority,operation,operations,"
+	       "failures,cycles_per_op,instret_per_op,revocations\n");
+
+	for (auto distribution : {Distribution::PowerLaw, Distribution::Bimodal})
+	{
+		for (auto order : {FreeOrder::LIFO, FreeOrder::FIFO, FreeOrder::Random})
+		{
+			run_free_order(distribution, order);
+		}
+		run_near_full_quota(distribution);
+		run_revocation(distribution);
+	}
+
+	// Start the workers and take part in the contention scenario at this
+	// thread's priority.
+	uint32_t startEpoch = revocation_epochs();
+	contentionStart     = 1;
+	contentionStart.notify_all();
+	contend(1);
+	wait_for(contentionFinished, ContentionThreads);
+	uint32_t revocations = revocation_epochs() - startEpoch;
+	for (size_t i = 0; i < ContentionThreads; i++)
+	{
+		report("contention",
+		       distribution_name(Distribution::PowerLaw),
+		       "random",
+		       i + 1,
+		       "allocate",
+		       contentionAllocations[i],
+		       revocations);
+		report("contention",
+		       distribution_name(Distribution::PowerLaw),
+		       "random",
+		       i + 1,
+		       "free",
+		       contentionFrees[i],
+		       revocations);
+	}
+
+	printf("----- end of results (HeapSize is %zd)\n", HeapSize);
+
+	return 0;
+}
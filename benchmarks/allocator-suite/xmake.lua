@@ -0,0 +1,51 @@
+-- Copyright Microsoft and CHERIoT Contributors.
+-- SPDX-License-Identifier: MIT
+
+set_project("CHERIoT allocator benchmark suite");
+sdkdir = "../../sdk"
+includes(sdkdir)
+set_toolchains("cheriot-clang")
+
+option("board")
+    set_default("sail")
+
+debugOption("allocsuite");
+compartment("allocsuite")
+    add_deps("crt", "freestanding", "atomic", "stdio", "debug")
+    -- Allow allocating an effectively unbounded amount of memory (more than exists)
+    add_rules("cheriot.component-debug")
+    add_defines("MALLOC_QUOTA=1000000")
+    add_defines("BOARD=" .. tostring(get_config("board")))
+    add_files("suite.cc")
+
+-- Firmware image for the example.  The two worker threads only take part in
+-- the contention scenario, which `run` starts once the single-threaded
+-- scenarios are finished.
+firmware("allocator-suite-benchmark")
+    add_deps("allocsuite")
+    on_load(function(target)
+        target:values_set("board", "$(board)")
+        target:values_set("threads", {
+            {
+                compartment = "allocsuite",
+                priority = 1,
+                entry_point = "run",
+                stack_size = 0x600,
+                trusted_stack_frames = 4
+            },
+            {
+                compartment = "allocsuite",
+                priority = 2,
+                entry_point = "worker_medium",
+                stack_size = 0x600,
+                trusted_stack_frames = 4
+            },
+            {
+                compartment = "allocsuite",
+                priority = 3,
+                entry_point = "worker_high",
+                stack_size = 0x600,
+                trusted_stack_frames = 4
+            },
+        }, {expand = false})
+    end)
@@ -0,0 +1,118 @@
+#include "../timing.h"
+#include <compartment.h>
+#include <debug.hh>
+#include <stdlib.h>
+
+using Debug = ConditionalDebug<DEBUG_FREEALLBENCH, "heap_free_all benchmark">;
+
+/**
+ * Quota used for the allocations that are released with `heap_free_all`.
+ */
+DECLARE_AND_DEFINE_ALLOCATOR_CAPABILITY(ownedHeap, 16384);
+#define OWNED_HEAP STATIC_SEALED_VALUE(ownedHeap)
+
+namespace
+{
+	/**
+	 * Size of each allocation, both owned and background.
+	 */
+	constexpr size_t AllocSize = 32;
+
+	/**
+	 * Number of allocations made against `OWNED_HEAP` and released by each
+	 * timed `heap_free_all` call.
+	 */
+	constexpr size_t OwnedAllocations = 16;
+
+	/**
+	 * Allocate `count` objects against the default quota, which the
+	 * `heap_free_all` call being measured must not touch.  Returns the number
+	 * of allocations that succeeded.
+	 */
+	size_t fill_background(size_t count)
+	{
+		Timeout noWait{0};
+		for (size_t i = 0; i < count; i++)
+		{
+			void *ptr = heap_allocate(
+			  &noWait, MALLOC_CAPABILITY, AllocSize, AllocateWaitNone);
+			if (!__builtin_cheri_tag_get(ptr))
+			{
+				return i;
+			}
+		}
+		return count;
+	}
+
+	/**
+	 * Time a `heap_free_all` call that releases `OwnedAllocations` objects
+	 * with `background` other live objects in the heap.  The call holds the
+	 * allocator lock for almost all of its duration, so this approximates
+	 * the time for which other threads are blocked.
+	 */
+	void run(size_t background)
+	{
+		Timeout noWait{0};
+		for (size_t i = 0; i < OwnedAllocations; i++)
+		{
+			void *ptr = heap_allocate(&noWait, OWNED_HEAP, AllocSize);
+			Debug::Invariant(__builtin_cheri_tag_get(ptr),
+			                 "Owned allocation {} failed",
+			                 i);
+		}
+
+		auto start = rdcycle();
+		auto freed = heap_free_all(OWNED_HEAP);
+		auto end   = rdcycle();
+
+		Debug::Invariant(freed > 0, "heap_free_all failed: {}", freed);
+
+		printf(__XSTRING(BOARD) "\t%ld\t%ld\t%ld\n",
+		       background,
+		       OwnedAllocations,
+		       end - start);
+	}
+} // namespace
+
+/**
+ * Measure how long `heap_free_all` takes to release a fixed number of
+ * allocations as the rest of the heap fills up with objects belonging to a
+ * different quota.
+ */
+int __cheri_compartment("freeallbench") run()
+{
+	const ptraddr_t HeapStart = LA_ABS(__export_mem_heap);
+	const ptraddr_t HeapEnd   = LA_ABS(__export_mem_heap_end);
+
+	const size_t HeapSize = HeapEnd - HeapStart;
+
+	// Make sure sail doesn't print annoying log messages in the middle of the
+	// output the first time that allocation happens.
+	free(malloc(16));
+
+	printf("#board\tbackground\towned\ttime\n");
+
+	// Leave space for the owned allocations and their headers.
+	const size_t MaxBackground =
+	  (HeapSize / (AllocSize + 8)) - (2 * OwnedAllocations);
+	size_t background = 0;
+	for (size_t target = 0; target <= MaxBackground;
+	     target       = (target == 0) ? 64 : target * 2)
+	{
+		background += fill_background(target - background);
+		run(background);
+		if (background < target)
+		{
+			break;
+		}
+	}
+
+	Debug::Invariant(heap_free_all(MALLOC_CAPABILITY) >= 0,
+	                 "Failed to free background allocations");
+	Debug::Invariant(heap_quarantine_empty() == 0,
+	                 "Call to heap_quarantine_empty failed");
+
+	printf("----- end of results (HeapSize is %zd)\n", HeapSize);
+
+	return 0;
+}
@@ -0,0 +1,152 @@
+#include "../timing.h"
+#include <algorithm>
+#include <compartment.h>
+#include <debug.hh>
+#include <stdlib.h>
+#include <thread.h>
+
+using Debug = ConditionalDebug<DEBUG_DRAINBENCH, "Quarantine drain benchmark">;
+
+namespace
+{
+	/**
+	 * Size of each allocation.
+	 */
+	constexpr size_t AllocSize = 128;
+
+	/**
+	 * The largest burst that we will try.
+	 */
+	constexpr size_t MaxBurst = 1024;
+
+	/**
+	 * Number of times to repeat each burst size.
+	 */
+	constexpr size_t Rounds = 4;
+
+	/**
+	 * Objects allocated in the current burst.
+	 */
+	void *objects[MaxBurst];
+
+	/**
+	 * Cycle counts for each successful allocation in the current burst.
+	 */
+	int latencies[MaxBurst];
+
+	/**
+	 * Allocate `burst` objects without blocking, recording the time taken by
+	 * each successful allocation.  Returns the number that failed.
+	 */
+	size_t allocate_burst(size_t burst, size_t &succeeded)
+	{
+		Timeout noWait{0};
+		size_t  failures = 0;
+		succeeded        = 0;
+		for (size_t i = 0; i < burst; i++)
+		{
+			auto  start = rdcycle();
+			void *ptr   = heap_allocate(&noWait, MALLOC_CAPABILITY, AllocSize);
+			auto  end   = rdcycle();
+			if (__builtin_cheri_tag_get(ptr))
+			{
+				objects[succeeded]     = ptr;
+				latencies[succeeded++] = end - start;
+			}
+			else
+			{
+				failures++;
+			}
+		}
+		return failures;
+	}
+
+	/**
+	 * Free the first `count` objects in `objects`.
+	 */
+	void free_burst(size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			Debug::Invariant(heap_free(MALLOC_CAPABILITY, objects[i]) == 0,
+			                 "Failed to free object {}",
+			                 i);
+		}
+	}
+
+	/**
+	 * Allocate a burst of `burst` objects, free them all at once, give the
+	 * revoker a little time, and then immediately allocate the same number
+	 * again.  The second burst competes with the first burst's objects, which
+	 * are still in quarantine, so reports how often allocation fails and how
+	 * long the successful allocations take.
+	 */
+	void run(size_t burst)
+	{
+		size_t succeeded;
+		allocate_burst(burst, succeeded);
+		free_burst(succeeded);
+
+		// Let an asynchronous revoker make progress, without draining the
+		// quarantine ourselves.
+		Timeout wait{2};
+		thread_sleep(&wait, ThreadSleepNoEarlyWake);
+
+		size_t failures = allocate_burst(burst, succeeded);
+		std::sort(latencies, latencies + succeeded);
+		int median = (succeeded > 0) ? latencies[succeeded / 2] : 0;
+		int p99    = (succeeded > 0) ? latencies[(succeeded * 99) / 100] : 0;
+		int max    = (succeeded > 0) ? latencies[succeeded - 1] : 0;
+		free_burst(succeeded);
+
+		printf(__XSTRING(BOARD) "\t%s\t%ld\t%ld\t%ld\t%d\t%d\t%d\n",
+		       __XSTRING(DRAIN_POLICY),
+		       AllocSize,
+		       burst,
+		       failures,
+		       median,
+		       p99,
+		       max);
+
+		Debug::Invariant(heap_quarantine_empty() == 0,
+		                 "Call to heap_quarantine_empty failed");
+	}
+} // namespace
+
+/**
+ * Measure allocation failure rates and latency for allocations that
+ * immediately follow a burst of frees, with bursts ranging from a quarter to
+ * three quarters of the heap.  Build with
+ * `--allocator-quarantine-drain=fixed` and `=adaptive` to compare policies.
+ */
+int __cheri_compartment("drainbench") run()
+{
+	const ptraddr_t HeapStart = LA_ABS(__export_mem_heap);
+	const ptraddr_t HeapEnd   = LA_ABS(__export_mem_heap_end);
+
+	const size_t HeapSize = HeapEnd - HeapStart;
+
+	// Make sure sail doesn't print annoying log messages in the middle of the
+	// output the first time that allocation happens.
+	free(malloc(16));
+
+	Debug::Invariant(heap_quarantine_empty() == 0,
+	                 "Call to heap_quarantine_empty failed");
+
+	printf("#board\tpolicy\tsize\tburst\tfailures\tmedian\tp99\tmax\n");
+
+	for (size_t eighths = 2; eighths <= 6; eighths++)
+	{
+		// Each allocation also uses an 8-byte header.
+		size_t burst =
+		  std::min((HeapSize * eighths) / (8 * (AllocSize + 8)), MaxBurst);
+		for (size_t i = 0; i < Rounds; i++)
+		{
+			run(burst);
+		}
+	}
+
+	printf("----- end of results (HeapSize is %zd)\n", HeapSize);
+
+	return 0;
+}
@@ -0,0 +1,109 @@
+#include "../timing.h"
+#include <algorithm>
+#include <cheriot-atomic.hh>
+#include <compartment.h>
+#include <debug.hh>
+#include <stdlib.h>
+#include <thread.h>
+
+using Debug = ConditionalDebug<DEBUG_SWEEPBENCH, "Revocation sweep benchmark">;
+
+namespace
+{
+	/**
+	 * Number of complete revocation passes to time.
+	 */
+	constexpr size_t Passes = 16;
+
+	/**
+	 * Cycle counts for each revocation pass.
+	 */
+	int passCycles[Passes];
+
+	/**
+	 * Set by `run` when it has finished, to stop the observer.
+	 */
+	cheriot::atomic<uint32_t> finished;
+
+	/**
+	 * Set by the observer when it has stopped and its results are ready.
+	 */
+	cheriot::atomic<uint32_t> observed;
+
+	/**
+	 * The shortest and longest times between the observer's wakeups.
+	 */
+	int shortestPeriod = INT32_MAX;
+	int longestPeriod  = 0;
+} // namespace
+
+/**
+ * Sleep for one tick at a time until `run` has finished, recording the
+ * shortest and longest times between wakeups.  The difference between these
+ * is the longest that this thread's wakeup was delayed, which includes the
+ * longest time that the revoker ran with interrupts disabled.
+ */
+int __cheri_compartment("sweepbench") observe()
+{
+	int last = rdcycle();
+	while (finished.load() == 0)
+	{
+		Timeout t{1};
+		thread_sleep(&t, ThreadSleepNoEarlyWake);
+		int now        = rdcycle();
+		shortestPeriod = std::min(shortestPeriod, now - last);
+		longestPeriod  = std::max(longestPeriod, now - last);
+		last           = now;
+	}
+	observed = 1;
+	observed.notify_all();
+	return 0;
+}
+
+/**
+ * Time complete revocation passes, each started by freeing an object and
+ * finished by waiting for the quarantine to empty.  Build with different
+ * values of `--software-revoker-tick-cycles` to compare the time that each
+ * pass takes with the delay that it causes to a higher-priority thread.  A
+ * value of 0 selects the original behaviour, which scans a fixed amount of
+ * memory in each step.
+ */
+int __cheri_compartment("sweepbench") run()
+{
+	// Make sure sail doesn't print annoying log messages in the middle of the
+	// output the first time that allocation happens.
+	free(malloc(16));
+
+	Debug::Invariant(heap_quarantine_empty() == 0,
+	                 "Call to heap_quarantine_empty failed");
+
+	printf("#board\ttick_cycles\tpasses\tmedian\tmax\tjitter\n");
+
+	for (auto &cycles : passCycles)
+	{
+		auto start = rdcycle();
+		free(malloc(16));
+		Debug::Invariant(heap_quarantine_empty() == 0,
+		                 "Call to heap_quarantine_empty failed");
+		cycles = rdcycle() - start;
+	}
+
+	finished = 1;
+	uint32_t done;
+	while ((done = observed.load()) == 0)
+	{
+		observed.wait(done);
+	}
+
+	std::sort(std::begin(passCycles), std::end(passCycles));
+	printf(__XSTRING(BOARD) "\t%s\t%ld\t%d\t%d\t%d\n",
+	       __XSTRING(TICK_CYCLES),
+	       Passes,
+	       passCycles[Passes / 2],
+	       passCycles[Passes - 1],
+	       longestPeriod - shortestPeriod);
+
+	printf("----- end of results\n");
+
+	return 0;
+}
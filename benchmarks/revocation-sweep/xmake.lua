@@ -0,0 +1,43 @@
+-- Copyright Microsoft and CHERIoT Contributors.
+-- SPDX-License-Identifier: MIT
+
+set_project("CHERIoT revocation sweep benchmark");
+sdkdir = "../../sdk"
+includes(sdkdir)
+set_toolchains("cheriot-clang")
+
+option("board")
+    set_default("sail")
+
+debugOption("sweepbench");
+compartment("sweepbench")
+    add_deps("crt", "freestanding", "atomic", "stdio", "debug")
+    add_rules("cheriot.component-debug")
+    add_defines("BOARD=" .. tostring(get_config("board")))
+    add_defines("TICK_CYCLES=" .. tostring(get_config("software-revoker-tick-cycles")))
+    add_files("sweep.cc")
+
+-- Firmware image for the example.  The observer thread runs at a higher
+-- priority than the thread that drives revocation, so that it measures how
+-- long revocation delays it.
+firmware("revocation-sweep-benchmark")
+    add_deps("sweepbench")
+    on_load(function(target)
+        target:values_set("board", "$(board)")
+        target:values_set("threads", {
+            {
+                compartment = "sweepbench",
+                priority = 1,
+                entry_point = "run",
+                stack_size = 0x400,
+                trusted_stack_frames = 4
+            },
+            {
+                compartment = "sweepbench",
+                priority = 2,
+                entry_point = "observe",
+                stack_size = 0x400,
+                trusted_stack_frames = 4
+            },
+        }, {expand = false})
+    end)
@@ -0,0 +1,116 @@
+#include "../timing.h"
+#include <algorithm>
+#include <compartment.h>
+#include <debug.hh>
+#include <stdlib.h>
+#include <thread.h>
+#include <token.h>
+
+using Debug = ConditionalDebug<DEBUG_SEALBENCH, "Sealed object benchmark">;
+
+namespace
+{
+	/**
+	 * Sizes of sealed object to test.  The smallest is the size of a
+	 * scheduler handle, such as a multiwaiter or an event group.
+	 */
+	constexpr size_t Sizes[] = {16, 64, 128, 256};
+
+	/**
+	 * Number of objects that are created and then destroyed together.
+	 */
+	constexpr size_t Batch = 4;
+
+	/**
+	 * Number of batches for each size.
+	 */
+	constexpr size_t Rounds = 32;
+
+	/**
+	 * Cycle counts for each allocation and destruction for the current size.
+	 */
+	int allocateLatencies[Batch * Rounds];
+	int destroyLatencies[Batch * Rounds];
+
+	/**
+	 * Returns the median of the first `count` values in `latencies`, sorting
+	 * them in the process.
+	 */
+	int median(int *latencies, size_t count)
+	{
+		std::sort(latencies, latencies + count);
+		return latencies[count / 2];
+	}
+
+	/**
+	 * Repeatedly create a batch of `size`-byte sealed objects and destroy
+	 * them again, as a compartment that uses short-lived message queues or
+	 * multiwaiters would, and report the median time for each operation.
+	 * Between batches, give an asynchronous revoker a little time so that
+	 * destroyed objects can become reusable.
+	 */
+	void run(SKey key, size_t size)
+	{
+		size_t samples = 0;
+		for (size_t round = 0; round < Rounds; round++)
+		{
+			CHERI_SEALED(void *) objects[Batch];
+			for (size_t i = 0; i < Batch; i++)
+			{
+				Timeout t{UnlimitedTimeout};
+				auto    start = rdcycle();
+				objects[i] =
+				  token_sealed_alloc(&t, MALLOC_CAPABILITY, key, size);
+				auto end = rdcycle();
+				Debug::Invariant(__builtin_cheri_tag_get(objects[i]),
+				                 "Failed to allocate {}-byte sealed object",
+				                 size);
+				allocateLatencies[samples + i] = end - start;
+			}
+			for (size_t i = 0; i < Batch; i++)
+			{
+				auto start = rdcycle();
+				int  ret =
+				  token_obj_destroy(MALLOC_CAPABILITY, key, objects[i]);
+				auto end = rdcycle();
+				Debug::Invariant(ret == 0, "Failed to destroy sealed object");
+				destroyLatencies[samples + i] = end - start;
+			}
+			samples += Batch;
+			Timeout wait{1};
+			thread_sleep(&wait, ThreadSleepNoEarlyWake);
+		}
+		printf(__XSTRING(BOARD) "\t%s\t%ld\t%d\t%d\n",
+		       __XSTRING(SEALED_CACHE),
+		       size,
+		       median(allocateLatencies, samples),
+		       median(destroyLatencies, samples));
+		Debug::Invariant(heap_quarantine_empty() == 0,
+		                 "Call to heap_quarantine_empty failed");
+	}
+} // namespace
+
+/**
+ * Measure the cost of creating and destroying sealed objects.  Build with
+ * `--allocator-sealed-cache=y` and `=n` to compare the allocator's
+ * sealed-object cache against the general allocation path.
+ */
+int __cheri_compartment("sealbench") run()
+{
+	// Make sure sail doesn't print annoying log messages in the middle of the
+	// output the first time that allocation happens.
+	free(malloc(16));
+
+	SKey key = token_key_new();
+	Debug::Invariant(__builtin_cheri_tag_get(key),
+	                 "Failed to allocate a sealing key");
+
+	printf("#board\tcache\tsize\tallocate\tdestroy\n");
+	for (size_t size : Sizes)
+	{
+		run(key, size);
+	}
+	printf("----- end of results\n");
+
+	return 0;
+}
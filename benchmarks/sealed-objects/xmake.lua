@@ -0,0 +1,34 @@
+-- Copyright Microsoft and CHERIoT Contributors.
+-- SPDX-License-Identifier: MIT
+
+set_project("CHERIoT sealed object allocation benchmark");
+sdkdir = "../../sdk"
+includes(sdkdir)
+set_toolchains("cheriot-clang")
+
+option("board")
+    set_default("sail")
+
+debugOption("sealbench");
+compartment("sealbench")
+    add_deps("crt", "freestanding", "atomic", "stdio", "debug")
+    add_rules("cheriot.component-debug")
+    add_defines("BOARD=" .. tostring(get_config("board")))
+    add_defines("SEALED_CACHE=" .. tostring(get_config("allocator-sealed-cache")))
+    add_files("sealed.cc")
+
+-- Firmware image for the example.
+firmware("sealed-objects-benchmark")
+    add_deps("sealbench")
+    on_load(function(target)
+        target:values_set("board", "$(board)")
+        target:values_set("threads", {
+            {
+                compartment = "sealbench",
+                priority = 1,
+                entry_point = "run",
+                stack_size = 0x400,
+                trusted_stack_frames = 4
+            },
+        }, {expand = false})
+    end)
@@ -0,0 +1,188 @@
+#include "../timing.h"
+#include <algorithm>
+#include <cheriot-atomic.hh>
+#include <compartment.h>
+#include <debug.hh>
+#include <simulator.h>
+#include <thread.h>
+#include <timeout.h>
+
+using Debug = ConditionalDebug<DEBUG_SLEEPBENCH, "Sleeping threads benchmark">;
+
+namespace
+{
+	/**
+	 * The number of sleeper threads in the firmware image.
+	 */
+	constexpr uint32_t Sleepers = SLEEPERS;
+
+	/**
+	 * The number of context-switch round trips to time for each number of
+	 * sleeping threads.
+	 */
+	constexpr size_t RoundTrips = 32;
+
+	/**
+	 * The number of timer interrupts to time for each number of sleeping
+	 * threads.
+	 */
+	constexpr size_t TimerInterrupts = 32;
+
+	/**
+	 * The smallest gap between two reads of the cycle counter that is
+	 * assumed to be caused by an interrupt rather than by the loop itself.
+	 */
+	constexpr int InterruptThreshold = 200;
+
+	/**
+	 * How long the sleepers sleep for, in ticks.  This is much longer than
+	 * the benchmark takes to run, so they stay asleep until they are told to
+	 * exit.
+	 */
+	constexpr uint32_t SleeperTicks = 100000;
+
+	/**
+	 * How long the partner thread waits for, in ticks.  This is shorter than
+	 * the sleepers' timeouts, so that it is inserted ahead of them in the
+	 * timer queue.
+	 */
+	constexpr uint32_t PartnerTicks = 10000;
+
+	/**
+	 * Incremented to wake the partner thread.
+	 */
+	cheriot::atomic<uint32_t> ping;
+
+	/**
+	 * Non-zero while the ticker thread should wake up every tick.
+	 */
+	cheriot::atomic<uint32_t> ticking;
+
+	/**
+	 * Sleepers wait on this word, one is woken each time that it should exit.
+	 */
+	cheriot::atomic<uint32_t> exiting;
+
+	/**
+	 * Returns the median of `samples`, sorting them in the process.
+	 */
+	template<size_t N>
+	int median(int (&samples)[N])
+	{
+		std::sort(std::begin(samples), std::end(samples));
+		return samples[N / 2];
+	}
+} // namespace
+
+/**
+ * Sleep until either woken to exit or the (long) timeout expires.  Each sleeper
+ * uses a different timeout, so that they are spread out in the timer queue.
+ */
+int __cheri_compartment("sleepbench") sleeper()
+{
+	Timeout t{SleeperTicks + thread_id_get()};
+	exiting.wait(&t, 0);
+	Debug::log("Sleeper {} exiting", thread_id_get());
+	return 0;
+}
+
+/**
+ * Wait for `ping` to change, with a timeout so that each wait is inserted into
+ * the timer queue.
+ */
+int __cheri_compartment("sleepbench") partner()
+{
+	uint32_t last = 0;
+	while (true)
+	{
+		Timeout t{PartnerTicks};
+		ping.wait(&t, last);
+		last = ping.load();
+	}
+}
+
+/**
+ * While `ticking` is set, sleep for one tick at a time.  Each wakeup is caused
+ * by a timer interrupt, which makes this thread runnable.
+ */
+int __cheri_compartment("sleepbench") ticker()
+{
+	while (true)
+	{
+		uint32_t shouldTick;
+		while ((shouldTick = ticking.load()) == 0)
+		{
+			ticking.wait(shouldTick);
+		}
+		Timeout t{1};
+		thread_sleep(&t, ThreadSleepNoEarlyWake);
+	}
+}
+
+/**
+ * Measure the cost of context switches and timer interrupts with a
+ * decreasing number of threads sleeping with a timeout.  All of the sleepers
+ * have a higher priority than this thread and so are asleep before this
+ * starts.  After each measurement, one sleeper is woken and exits.
+ *
+ * A context switch is measured as the time taken to wake the partner thread,
+ * which runs immediately and then waits again with a timeout before this
+ * thread resumes.  A timer interrupt is measured as the time that this thread
+ * loses each time that the ticker thread wakes up and goes back to sleep.
+ */
+int __cheri_compartment("sleepbench") run()
+{
+	printf("#board\tsleeping\tswitch_median\tswitch_max\ttimer_median\t"
+	       "timer_max\n");
+
+	for (uint32_t sleeping = Sleepers;; sleeping--)
+	{
+		int switches[RoundTrips];
+		for (auto &cycles : switches)
+		{
+			int start = rdcycle();
+			ping++;
+			ping.notify_one();
+			cycles = rdcycle() - start;
+		}
+
+		int interrupts[TimerInterrupts];
+		ticking = 1;
+		ticking.notify_one();
+		int last = rdcycle();
+		for (auto &cycles : interrupts)
+		{
+			int now;
+			while (((now = rdcycle()) - last) < InterruptThreshold)
+			{
+				last = now;
+			}
+			cycles = now - last;
+			last   = now;
+		}
+		ticking = 0;
+
+		int switchMax =
+		  *std::max_element(std::begin(switches), std::end(switches));
+		int interruptMax =
+		  *std::max_element(std::begin(interrupts), std::end(interrupts));
+		printf(__XSTRING(BOARD) "\t%u\t%d\t%d\t%d\t%d\n",
+		       sleeping,
+		       median(switches),
+		       switchMax,
+		       median(interrupts),
+		       interruptMax);
+
+		if (sleeping == 0)
+		{
+			break;
+		}
+		exiting = 1;
+		exiting.notify_one();
+	}
+
+	printf("----- end of results\n");
+	// The partner and ticker threads never exit.
+	simulation_exit(0);
+	return 0;
+}
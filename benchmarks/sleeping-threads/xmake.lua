@@ -0,0 +1,64 @@
+-- Copyright Microsoft and CHERIoT Contributors.
+-- SPDX-License-Identifier: MIT
+
+set_project("CHERIoT sleeping-threads benchmark");
+sdkdir = "../../sdk"
+includes(sdkdir)
+set_toolchains("cheriot-clang")
+
+option("board")
+    set_default("sail")
+
+-- The number of threads that are progressively put to sleep.
+local sleepers = 16
+
+debugOption("sleepbench");
+compartment("sleepbench")
+    add_deps("crt", "freestanding", "atomic", "stdio", "debug")
+    add_rules("cheriot.component-debug")
+    add_defines("BOARD=" .. tostring(get_config("board")))
+    add_defines("SLEEPERS=" .. sleepers)
+    add_files("sleep.cc")
+
+-- Firmware image for the example.  The partner and ticker threads run at a
+-- higher priority than `run`, so that waking them causes an immediate context
+-- switch.  The sleepers run at a higher priority still, so that they are all
+-- asleep before `run` starts.
+firmware("sleeping-threads-benchmark")
+    add_deps("sleepbench")
+    on_load(function(target)
+        target:values_set("board", "$(board)")
+        local threads = {
+            {
+                compartment = "sleepbench",
+                priority = 1,
+                entry_point = "run",
+                stack_size = 0x400,
+                trusted_stack_frames = 4
+            },
+            {
+                compartment = "sleepbench",
+                priority = 2,
+                entry_point = "partner",
+                stack_size = 0x400,
+                trusted_stack_frames = 4
+            },
+            {
+                compartment = "sleepbench",
+                priority = 2,
+                entry_point = "ticker",
+                stack_size = 0x400,
+                trusted_stack_frames = 4
+            },
+        }
+        for i = 1, sleepers do
+            table.insert(threads, {
+                compartment = "sleepbench",
+                priority = 3,
+                entry_point = "sleeper",
+                stack_size = 0x300,
+                trusted_stack_frames = 4
+            })
+        end
+        target:values_set("threads", threads, {expand = false})
+    end)
@@ -0,0 +1,150 @@
+#include "../timing.h"
+#include <algorithm>
+#include <compartment.h>
+#include <debug.hh>
+#include <stdlib.h>
+#include <type_traits>
+
+using Debug = ConditionalDebug<DEBUG_REPLAYBENCH, "Trace replay benchmark">;
+
+namespace
+{
+	/**
+	 * An operation in the replayed trace.  Allocations store a result in
+	 * `slot`, frees release the object stored in `slot`.
+	 */
+	struct TraceOperation
+	{
+		uint16_t slot;
+		uint32_t size;
+	};
+
+	/**
+	 * The size used to mark a free in the trace.
+	 */
+	constexpr uint32_t TraceFree = UINT32_MAX;
+
+#define TRACE_ALLOCATE(slot, size)                                             \
+	TraceOperation                                                             \
+	{                                                                          \
+		slot, size                                                             \
+	}
+#define TRACE_FREE(slot)                                                       \
+	TraceOperation                                                             \
+	{                                                                          \
+		slot, TraceFree                                                        \
+	}
+	/**
+	 * The trace.  `trace.inc` is generated from the output of
+	 * `heap_trace_dump` with `scripts/allocator_trace.py header`.
+	 */
+	constexpr TraceOperation Trace[] = {
+#include "trace.inc"
+	};
+#undef TRACE_ALLOCATE
+#undef TRACE_FREE
+
+	/**
+	 * The number of objects that are live at the same time in the trace.
+	 */
+	constexpr size_t TraceSlots = []() {
+		size_t slots = 0;
+		for (auto &op : Trace)
+		{
+			slots = std::max<size_t>(slots, op.slot + 1);
+		}
+		return slots;
+	}();
+
+	/**
+	 * Number of times to replay the trace.
+	 */
+	constexpr size_t Rounds = 4;
+
+	/**
+	 * The objects that are live in the replay.
+	 */
+	void *slots[TraceSlots];
+
+	/**
+	 * Replay the trace once and print the cycles spent in allocation and free,
+	 * the number of allocations that failed, and the worst fragmentation of
+	 * free memory seen after any allocation.  Fragmentation is the proportion
+	 * of free memory, in thousandths, that is not in the largest free chunk.
+	 */
+	void replay(size_t round)
+	{
+		Timeout noWait{0};
+		size_t  allocateCycles     = 0;
+		size_t  freeCycles         = 0;
+		size_t  failures           = 0;
+		size_t  worstFragmentation = 0;
+		for (auto &op : Trace)
+		{
+			if (op.size == TraceFree)
+			{
+				if (slots[op.slot] == nullptr)
+				{
+					continue;
+				}
+				auto start = rdcycle();
+				int  ret   = heap_free(MALLOC_CAPABILITY, slots[op.slot]);
+				auto end   = rdcycle();
+				Debug::Invariant(ret == 0, "Failed to free: {}", ret);
+				freeCycles += end - start;
+				slots[op.slot] = nullptr;
+				continue;
+			}
+			auto  start = rdcycle();
+			void *ptr   = heap_allocate(&noWait, MALLOC_CAPABILITY, op.size);
+			auto  end   = rdcycle();
+			allocateCycles += end - start;
+			if (!__builtin_cheri_tag_get(ptr))
+			{
+				failures++;
+				continue;
+			}
+			slots[op.slot] = ptr;
+			HeapStats stats;
+			if ((heap_stats(MALLOC_CAPABILITY, &stats) == 0) &&
+			    (stats.freeBytes > 0))
+			{
+				size_t fragmentation =
+				  ((stats.freeBytes - stats.largestFreeChunk) * 1000) /
+				  stats.freeBytes;
+				worstFragmentation =
+				  std::max(worstFragmentation, fragmentation);
+			}
+		}
+		printf(__XSTRING(BOARD) "\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\n",
+		       round,
+		       std::extent_v<decltype(Trace)>,
+		       allocateCycles,
+		       freeCycles,
+		       failures,
+		       worstFragmentation);
+		Debug::Invariant(heap_quarantine_empty() == 0,
+		                 "Call to heap_quarantine_empty failed");
+	}
+} // namespace
+
+/**
+ * Replay an allocation trace recorded with `heap_trace_dump` against the
+ * allocator.
+ */
+int __cheri_compartment("replaybench") run()
+{
+	// Make sure sail doesn't print annoying log messages in the middle of the
+	// output the first time that allocation happens.
+	free(malloc(16));
+
+	printf("#board\tround\toperations\tallocate\tfree\tfailures\t"
+	       "fragmentation\n");
+	for (size_t round = 0; round < Rounds; round++)
+	{
+		replay(round);
+	}
+	printf("----- end of results\n");
+
+	return 0;
+}
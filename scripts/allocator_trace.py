@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+# Copyright Microsoft and CHERIoT Contributors.
+# SPDX-License-Identifier: MIT
+
+"""
+Decode the allocation trace that `heap_trace_dump()` prints when the RTOS is
+built with `--allocator-trace=y`.
+
+The `decode` command converts the trace to CSV, `summary` prints operation
+counts, the peak number of live bytes, and a histogram of allocation sizes,
+and `header` generates a `trace.inc` file for the `trace-replay` benchmark.
+"""
+
+import argparse, csv, re, sys
+
+# Values of the allocator's TraceOperation enumeration.
+operations = {1: 'allocate', 2: 'free', 3: 'claim', 4: 'free_all'}
+
+record_re = re.compile(
+    r'alloctrace (?P<timestamp>\S+) (?P<op>\S+) (?P<owner>\S+) '
+    r'(?P<size>\S+) (?P<address>\S+) (?P<result>\S+)')
+begin_re = re.compile(r'alloctrace-begin (?P<written>\S+) (?P<dropped>\S+)')
+
+
+def parse_int(text):
+    # The debug console prints unsigned values in hex and signed ones in
+    # decimal.
+    return int(text, 0)
+
+
+def read_trace(stream):
+    """
+    Yield a dictionary for each trace record in the console output read from
+    `stream`, ignoring any other output.
+    """
+    for line in stream:
+        m = begin_re.search(line)
+        if m:
+            dropped = parse_int(m.group('dropped'))
+            if dropped != 0:
+                sys.stderr.write(
+                    f"Warning: {dropped} records were overwritten before "
+                    "they were dumped\n")
+            continue
+        m = record_re.search(line)
+        if not m:
+            continue
+        record = {k: parse_int(v) for k, v in m.groupdict().items()}
+        record['op'] = operations.get(record['op'], str(record['op']))
+        yield record
+
+
+def decode(records, args):
+    writer = csv.writer(sys.stdout)
+    writer.writerow(['timestamp', 'op', 'owner', 'size', 'address', 'result'])
+    for r in records:
+        writer.writerow([r['timestamp'], r['op'], r['owner'], r['size'],
+                         hex(r['address']), r['result']])
+
+
+def summary(records, args):
+    counts = {}
+    failures = 0
+    live = {}
+    live_bytes = 0
+    peak_bytes = 0
+    sizes = {}
+    for r in records:
+        counts[r['op']] = counts.get(r['op'], 0) + 1
+        if r['result'] != 0:
+            failures += 1
+            continue
+        if r['op'] == 'allocate':
+            live[r['address']] = (r['owner'], r['size'])
+            live_bytes += r['size']
+            peak_bytes = max(peak_bytes, live_bytes)
+            bucket = 1 << max(r['size'] - 1, 0).bit_length()
+            sizes[bucket] = sizes.get(bucket, 0) + 1
+        elif r['op'] == 'free' and r['address'] in live:
+            live_bytes -= live.pop(r['address'])[1]
+        elif r['op'] == 'free_all':
+            for address in [a for a, (owner, _) in live.items()
+                            if owner == r['owner']]:
+                live_bytes -= live.pop(address)[1]
+    print('Operations:')
+    for op, count in sorted(counts.items()):
+        print(f'  {op:10} {count}')
+    print(f'Failed operations: {failures}')
+    print(f'Peak live bytes (requested sizes): {peak_bytes}')
+    print(f'Live bytes at end of trace: {live_bytes}')
+    print('Allocation sizes (rounded up to a power of two):')
+    for bucket, count in sorted(sizes.items()):
+        print(f'  <= {bucket:6} {count}')
+
+
+def header(records, args):
+    """
+    Convert the trace into a sequence of operations on numbered slots, which
+    the replay benchmark maps to live allocations.  Claims, failed operations,
+    and frees of objects that were allocated before the trace started are not
+    replayed.
+    """
+    free_slots = []
+    slots = {}
+    next_slot = 0
+    ops = []
+    for r in records:
+        if r['result'] != 0:
+            continue
+        if r['op'] == 'allocate':
+            if free_slots:
+                slot = free_slots.pop()
+            else:
+                slot = next_slot
+                next_slot += 1
+            slots[r['address']] = (slot, r['owner'])
+            ops.append(f'TRACE_ALLOCATE({slot}, {r["size"]})')
+        elif r['op'] == 'free' and r['address'] in slots:
+            slot = slots.pop(r['address'])[0]
+            free_slots.append(slot)
+            ops.append(f'TRACE_FREE({slot})')
+        elif r['op'] == 'free_all':
+            for address in [a for a, (_, owner) in slots.items()
+                            if owner == r['owner']]:
+                slot = slots.pop(address)[0]
+                free_slots.append(slot)
+                ops.append(f'TRACE_FREE({slot})')
+    with open(args.output, 'w') as out:
+        out.write('// Generated by scripts/allocator_trace.py, do not edit.\n')
+        for op in ops:
+            out.write(op + ',\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    input_parser = argparse.ArgumentParser(add_help=False)
+    input_parser.add_argument('input', nargs='?', type=argparse.FileType('r'),
+                              default=sys.stdin,
+                              help='Console output containing the trace')
+    commands = parser.add_subparsers(dest='command', required=True)
+    commands.add_parser('decode', parents=[input_parser],
+                        help='Print the trace as CSV')
+    commands.add_parser('summary', parents=[input_parser],
+                        help='Summarise the trace')
+    header_parser = commands.add_parser(
+        'header', parents=[input_parser],
+        help='Generate a replay workload for the trace-replay benchmark')
+    header_parser.add_argument('-o', '--output', default='trace.inc',
+                               help='Output file (default: trace.inc)')
+    args = parser.parse_args()
+    records = read_trace(args.input)
+    {'decode': decode, 'summary': summary, 'header': header}[args.command](
+        records, args)
+
+
+if __name__ == '__main__':
+    main()
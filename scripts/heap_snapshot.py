@@ -0,0 +1,269 @@
+#!/usr/bin/env python3
+# Copyright Microsoft and CHERIoT Contributors.
+# SPDX-License-Identifier: MIT
+
+"""
+Analyse the heap snapshots that `heap_snapshot_dump()` prints when the RTOS is
+built with `--allocator-snapshot=y`.
+
+The `decode` command converts a snapshot to CSV, `summary` prints the memory in
+each state, fragmentation, per-owner usage, and the largest allocation that can
+succeed, and `map` draws a map of each heap region.  If the input contains
+more than one snapshot, the last complete one is used unless `--snapshot`
+selects another.
+"""
+
+import argparse, csv, re, sys
+
+# Values of the allocator's MState::SnapshotState enumeration.
+states = {0: 'free', 1: 'in_use', 2: 'quarantined', 3: 'cached'}
+
+# Characters used for each state by the `map` command.
+map_chars = {'free': '.', 'in_use': '#', 'quarantined': 'q', 'cached': 'c'}
+
+chunk_re = re.compile(
+    r'heapsnap (?P<address>\S+) (?P<size>\S+) (?P<state>\S+) '
+    r'(?P<owner>\S+) (?P<sealed>\S+)')
+region_re = re.compile(r'heapsnap-region (?P<base>\S+) (?P<top>\S+)')
+
+# Size of the header at the start of each chunk.
+chunk_header_size = 8
+
+# Smallest chunk that the allocator will split off.
+min_chunk_size = 16
+
+# Width of the mantissa in CHERIoT capability bounds and the largest exponent
+# below the one used for the whole address space.
+bounds_mantissa_width = 9
+bounds_max_exponent = 14
+
+
+def parse_int(text):
+    # The debug console prints unsigned values in hex and signed ones in
+    # decimal.
+    return int(text, 0)
+
+
+def read_snapshots(stream):
+    """
+    Return a list of the complete snapshots in the console output read from
+    `stream`, ignoring any other output.  Each snapshot is a list of regions,
+    each of which is a dictionary with the region bounds and a list of chunks.
+    """
+    snapshots = []
+    current = None
+    for line in stream:
+        if 'heapsnap-begin' in line:
+            current = []
+            continue
+        if current is None:
+            continue
+        if 'heapsnap-end' in line:
+            snapshots.append(current)
+            current = None
+            continue
+        m = region_re.search(line)
+        if m:
+            current.append({'base': parse_int(m.group('base')),
+                            'top': parse_int(m.group('top')),
+                            'chunks': []})
+            continue
+        m = chunk_re.search(line)
+        if not m or not current:
+            continue
+        chunk = {k: parse_int(v) for k, v in m.groupdict().items()}
+        chunk['state'] = states.get(chunk['state'], str(chunk['state']))
+        chunk['sealed'] = chunk['sealed'] != 0
+        current[-1]['chunks'].append(chunk)
+    if current is not None:
+        sys.stderr.write('Warning: ignoring incomplete snapshot at end of '
+                         'input\n')
+    return snapshots
+
+
+def runs(chunks, usable):
+    """
+    Yield the (start, end) addresses of each run of adjacent chunks whose
+    states are in `usable`.
+    """
+    start = None
+    end = None
+    for c in chunks:
+        if c['state'] in usable:
+            if start is None:
+                start = c['address']
+            end = c['address'] + c['size']
+        elif start is not None:
+            yield start, end
+            start = None
+    if start is not None:
+        yield start, end
+
+
+def align_up(value, alignment):
+    return (value + alignment - 1) & ~(alignment - 1)
+
+
+def largest_allocation_in(start, end):
+    """
+    Return the largest allocation that fits in a free run of chunks from
+    `start` to `end`.  The object must start on a boundary that makes its
+    capability bounds precise, after the chunk header, and any space before
+    the header must be large enough to remain a free chunk.  This does not
+    consider quota.
+    """
+    best = 0
+    for exponent in range(bounds_max_exponent + 1):
+        alignment = max(1 << exponent, chunk_header_size)
+        body = align_up(start + chunk_header_size, alignment)
+        lead = body - chunk_header_size - start
+        if 0 < lead < min_chunk_size:
+            body = align_up(start + chunk_header_size + min_chunk_size,
+                            alignment)
+        available = end - body
+        if available <= 0:
+            continue
+        largest = ((1 << bounds_mantissa_width) - 1) << exponent
+        best = max(best, min(available - available % alignment, largest))
+    return best
+
+
+def largest_allocation(snapshot, usable):
+    return max([largest_allocation_in(start, end)
+                for region in snapshot
+                for start, end in runs(region['chunks'], usable)],
+               default=0)
+
+
+def decode(snapshot, args):
+    writer = csv.writer(sys.stdout)
+    writer.writerow(['region', 'address', 'size', 'state', 'owner', 'sealed'])
+    for region in snapshot:
+        for c in region['chunks']:
+            writer.writerow([hex(region['base']), hex(c['address']), c['size'],
+                             c['state'], c['owner'], int(c['sealed'])])
+
+
+def summary(snapshot, args):
+    totals = {}
+    owners = {}
+    free_chunks = []
+    for region in snapshot:
+        for c in region['chunks']:
+            totals[c['state']] = totals.get(c['state'], 0) + c['size']
+            if c['state'] == 'free':
+                free_chunks.append(c['size'])
+            elif c['state'] in ('in_use', 'quarantined'):
+                usage = owners.setdefault(
+                    c['owner'],
+                    {'chunks': 0, 'bytes': 0, 'sealed': 0, 'quarantined': 0})
+                if c['state'] == 'quarantined':
+                    usage['quarantined'] += c['size']
+                else:
+                    usage['chunks'] += 1
+                    usage['bytes'] += c['size']
+                    usage['sealed'] += int(c['sealed'])
+    print('Regions:')
+    for region in snapshot:
+        print(f'  {region["base"]:#010x}-{region["top"]:#010x} '
+              f'{len(region["chunks"])} chunks')
+    print('Bytes in each state (including chunk headers):')
+    for state in states.values():
+        print(f'  {state:12} {totals.get(state, 0)}')
+    free = sum(free_chunks)
+    largest_free = max(free_chunks, default=0)
+    print(f'Free chunks: {len(free_chunks)}, largest {largest_free}')
+    if free > 0:
+        print(f'Fragmentation (1 - largest free / free): '
+              f'{1 - largest_free / free:.2f}')
+    print('Largest allocation that can succeed: '
+          f'{largest_allocation(snapshot, {"free"})}')
+    print('Largest allocation after revocation and cache flushing: '
+          f'{largest_allocation(snapshot, {"free", "quarantined", "cached"})}')
+    print('Usage by owner (in-use chunks, bytes, sealed objects, bytes freed '
+          'but still in quarantine):')
+    for owner, usage in sorted(owners.items(), key=lambda o: -o[1]['bytes']):
+        print(f'  {owner:5} {usage["chunks"]:6} {usage["bytes"]:8} '
+              f'{usage["sealed"]:6} {usage["quarantined"]:8}')
+
+
+def draw_map(snapshot, args):
+    """
+    Draw each region as rows of characters, each covering `scale` bytes and
+    showing the state that covers most of those bytes.
+    """
+    print('Key: ' + ', '.join(f"'{c}' {s}" for s, c in map_chars.items()))
+    for region in snapshot:
+        size = region['top'] - region['base']
+        scale = args.scale
+        if scale is None:
+            scale = chunk_header_size
+            while size > scale * args.width * args.rows:
+                scale *= 2
+        print(f'Region {region["base"]:#010x}-{region["top"]:#010x}, '
+              f'{scale} bytes per character')
+        cells = {}
+        for c in region['chunks']:
+            address = c['address']
+            end = address + c['size']
+            while address < end:
+                cell = (address - region['base']) // scale
+                next_cell = region['base'] + (cell + 1) * scale
+                covered = min(end, next_cell) - address
+                counts = cells.setdefault(cell, {})
+                counts[c['state']] = counts.get(c['state'], 0) + covered
+                address += covered
+        row = ''
+        cell_count = (size + scale - 1) // scale
+        for cell in range(cell_count):
+            counts = cells.get(cell)
+            if counts:
+                row += map_chars.get(max(counts, key=counts.get), '?')
+            else:
+                row += ' '
+            if len(row) == args.width or cell == cell_count - 1:
+                address = region['base'] + (cell + 1 - len(row)) * scale
+                print(f'{address:#010x} {row}')
+                row = ''
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    input_parser = argparse.ArgumentParser(add_help=False)
+    input_parser.add_argument('input', nargs='?', type=argparse.FileType('r'),
+                              default=sys.stdin,
+                              help='Console output containing the snapshot')
+    input_parser.add_argument('--snapshot', type=int, default=-1,
+                              help='Index of the snapshot to analyse, '
+                              'negative values count from the end '
+                              '(default: -1)')
+    commands = parser.add_subparsers(dest='command', required=True)
+    commands.add_parser('decode', parents=[input_parser],
+                        help='Print the snapshot as CSV')
+    commands.add_parser('summary', parents=[input_parser],
+                        help='Summarise the snapshot')
+    map_parser = commands.add_parser('map', parents=[input_parser],
+                                     help='Draw a map of each heap region')
+    map_parser.add_argument('--width', type=int, default=64,
+                            help='Characters per row (default: 64)')
+    map_parser.add_argument('--rows', type=int, default=32,
+                            help='Approximate number of rows per region when '
+                            'choosing the scale (default: 32)')
+    map_parser.add_argument('--scale', type=int,
+                            help='Bytes per character (default: chosen to '
+                            'fit the region in --rows rows)')
+    args = parser.parse_args()
+    snapshots = read_snapshots(args.input)
+    if not snapshots:
+        sys.exit('No complete heap snapshot found in the input')
+    try:
+        snapshot = snapshots[args.snapshot]
+    except IndexError:
+        sys.exit(f'Snapshot {args.snapshot} not found, the input contains '
+                 f'{len(snapshots)}')
+    {'decode': decode, 'summary': summary, 'map': draw_map}[args.command](
+        snapshot, args)
+
+
+if __name__ == '__main__':
+    main()
@@ -289,6 +289,34 @@ struct __packed __aligned(MallocAlignment) MChunkHeader
 	 * stolen for other fields.
 	 */
 	static constexpr size_t OwnerIDWidth = 13;
+	/**
+	 * Owner ID reserved for free chunks that are held in the slab caches.
+	 * These chunks are marked as in use so that they are never coalesced with
+	 * their neighbours, but they do not belong to any allocator capability.
+	 * This value is never handed out to an allocator capability.
+	 */
+	static constexpr uint16_t SlabCachedOwnerID = (1U << OwnerIDWidth) - 1;
+	/**
+	 * Owner ID reserved for retired sealed objects that are held in the
+	 * allocator's sealed-object cache until they are reused.  This value is
+	 * never handed out to an allocator capability.
+	 */
+	static constexpr uint16_t SealedCachedOwnerID = SlabCachedOwnerID - 1;
+	/**
+	 * Owner ID reserved for objects that `heap_allocate_batch` has allocated
+	 * but not yet returned.  No allocator capability can free these, so they
+	 * cannot be freed while the batch waits without the lock.  This value is
+	 * never handed out to an allocator capability.
+	 */
+	static constexpr uint16_t BatchPendingOwnerID = SealedCachedOwnerID - 1;
+	/**
+	 * Owner ID reserved for the allocator's claim records.  These are charged
+	 * to the quota of the capability that made the claim but are not owned
+	 * by it, so a walk of the heap for that capability's objects never frees
+	 * them directly.  This value is never handed out to an allocator
+	 * capability.
+	 */
+	static constexpr uint16_t ClaimOwnerID = BatchPendingOwnerID - 1;
 	/**
 	 * Compressed size of the predecessor chunk.  See cell_prev().
 	 */
@@ -677,6 +705,55 @@ constexpr size_t MinRequest = MinChunkSize - sizeof(MChunkHeader);
 
 static_assert(MinChunkSize == CHERIOTHeapMinChunkSize);
 
+#if ALLOCATOR_ADAPTIVE_DRAIN
+/**
+ * The maximum number of chunks that a single allocation or free will move
+ * out of quarantine when the drain budget is scaled up under heap pressure.
+ * This bounds the extra latency that draining adds to any one call.
+ */
+constexpr size_t QuarantineDrainMax = 32;
+#endif
+
+#if ALLOCATOR_SLAB
+/**
+ * The largest chunk (including the header) that is served from the slab
+ * caches.  Requests of up to 128 bytes are handled by the slab front end.
+ */
+constexpr size_t SlabMaxChunkSize = 128 + sizeof(MChunkHeader);
+/**
+ * The number of slab size classes.  There is one class for each
+ * `MallocAlignment` granule between `MinChunkSize` and `SlabMaxChunkSize`, so
+ * every class holds chunks of exactly one size and the slab front end adds no
+ * internal fragmentation over the general allocator.
+ */
+constexpr size_t NSlabClasses =
+  ((SlabMaxChunkSize - MinChunkSize) >> MallocAlignShift) + 1;
+/**
+ * The number of objects carved out of a single general-heap chunk when a slab
+ * class is empty.
+ */
+constexpr size_t SlabPageObjects = 8;
+/**
+ * The maximum number of free chunks held in any one slab class.  Chunks that
+ * leave quarantine when their class is full are returned to the general
+ * allocator and coalesced as normal.
+ */
+constexpr size_t SlabClassLimit = 32;
+static_assert(SlabPageObjects <= SlabClassLimit);
+static_assert(SlabClassLimit <= UINT8_MAX);
+
+// Return the slab class index for a chunk of size s (including the header).
+static inline BIndex slab_index(size_t s)
+{
+	return (s - MinChunkSize) >> MallocAlignShift;
+}
+// Is this chunk size served by the slab caches?
+static inline bool is_slab_size(size_t s)
+{
+	return s <= SlabMaxChunkSize;
+}
+#endif
+
 // true if cap address a has acceptable alignment
 static inline bool is_aligned(CHERI::Capability<void> a)
 {
@@ -860,6 +937,13 @@ class MState
 	 */
 	Capability<void *> hazardQuarantine;
 
+	/**
+	 * Scratch array, the same size as the hazard pointer array, into which
+	 * `hazard_pointers_snapshot` copies the valid hazard pointers, sorted by
+	 * base address.
+	 */
+	Capability<void *> hazardSnapshot;
+
 	using RingSentinel = ds::linked_list::Sentinel<ChunkFreeLink>;
 	/*
 	 * Rings for each small bin size.  Use smallbin_at() for access to
@@ -908,10 +992,34 @@ class MState
 		  CHERI::Capability{&quarantineFinishedSentinel}.address());
 	}
 
+#if ALLOCATOR_SLAB
+	/*
+	 * Rings of free chunks for each slab size class.  These chunks have left
+	 * quarantine (and so have clear shadow bits and zeroed bodies) but remain
+	 * marked in use, owned by `MChunkHeader::SlabCachedOwnerID`, so that they
+	 * can be handed out again without touching the bins.  They are counted in
+	 * `heapFreeSize`.  Use slab_cache_at() for access to ensure proper CHERI
+	 * bounds!
+	 */
+	RingSentinel slabCaches[NSlabClasses];
+	/// The number of chunks on each of the `slabCaches` rings.
+	uint8_t slabCacheCounts[NSlabClasses];
+
+	// Returns the slab cache ring for class i.
+	auto slab_cache_at(BIndex i)
+	{
+		return rederive<RingSentinel>(
+		  CHERI::Capability{&slabCaches[i]}.address());
+	}
+#endif
+
 	// bitmap telling which bins are empty which are not
 	Binmap smallmap;
 	Binmap treemap;
-	size_t heapTotalSize;
+	// the number of free chunks in each bin, for heap_stats()
+	uint16_t smallbinChunkCounts[NSmallBins];
+	uint16_t treebinChunkCounts[NTreeBins];
+	size_t   heapTotalSize;
 	size_t heapFreeSize;
 	size_t heapQuarantineSize;
 
@@ -920,6 +1028,11 @@ class MState
 	 */
 	size_t hazardQuarantineOccupancy = 0;
 
+	/**
+	 * The number of entries in the `hazardSnapshot` array.
+	 */
+	size_t hazardSnapshotOccupancy = 0;
+
 	/**
 	 * Returns true if there are no objects in the `hazardQuarantine` array.
 	 */
@@ -940,6 +1053,21 @@ class MState
 		hazardQuarantine[hazardQuarantineOccupancy++] = ptr;
 	}
 
+	/**
+	 * Returns true if `ptr` is already in the hazard quarantine.
+	 */
+	bool hazard_quarantine_contains(CHERI::Capability<void> ptr)
+	{
+		for (size_t i = 0; i < hazardQuarantineOccupancy; i++)
+		{
+			if (CHERI::Capability{hazardQuarantine[i]} == ptr)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 	bool is_free_cap_inbounds(CHERI::Capability<void> mem)
 	{
 		return mem.is_subset_of(heapStart);
@@ -1017,6 +1145,14 @@ class MState
 		quarantinePendingRing.reset();
 		quarantineFinishedSentinel.reset();
 		heapQuarantineSize = 0;
+
+#if ALLOCATOR_SLAB
+		for (BIndex i = 0; i < NSlabClasses; ++i)
+		{
+			slab_cache_at(i)->reset();
+			slabCacheCounts[i] = 0;
+		}
+#endif
 	}
 
 	/**
@@ -1130,13 +1266,18 @@ class MState
 	 * object.  This allows it to be skipped when freeing all objects allocated
 	 * with a given quota.
 	 *
+	 * The returned memory is aligned to `alignment`, which must be a power of
+	 * two, or to the alignment required for a precise capability, whichever is
+	 * greater.
+	 *
 	 * @return User pointer if request can be satisfied, or a tag type
 	 * representing the error otherwise.
 	 */
 	AllocationResult mspace_dispatch(size_t   bytes,
 	                                 size_t  &quota,
 	                                 uint16_t identifier,
-	                                 bool     isSealed = false)
+	                                 bool     isSealed  = false,
+	                                 size_t   alignment = MallocAlignment)
 	{
 		if (!hazard_quarantine_is_empty())
 		{
@@ -1154,8 +1295,9 @@ class MState
 			return AllocationFailurePermanent{};
 		}
 		// Check this first so that quota exhaustion doesn't return temporary
-		// failure.
-		if (heapTotalSize < alignSize)
+		// failure.  This also ensures that padding for alignment can't
+		// overflow.
+		if ((heapTotalSize < alignSize) || (heapTotalSize < alignment))
 		{
 			return AllocationFailurePermanent{};
 		}
@@ -1169,7 +1311,9 @@ class MState
 			return AllocationFailureQuotaExceeded{};
 		}
 		CHERI::Capability<void> ret{mspace_memalign(
-		  alignSize, -CHERI::representable_alignment_mask(bytes))};
+		  alignSize,
+		  std::max<size_t>(alignment,
+		                   -CHERI::representable_alignment_mask(bytes)))};
 		if (ret == nullptr)
 		{
 			auto neededSize = alignSize + sizeof(MChunkHeader);
@@ -1267,27 +1411,143 @@ class MState
 	}
 
 	/**
-	 * Check whether `allocation` is in the hazard list.  Returns true if it is.
+	 * Try to grow the in-use chunk `p` in place, by absorbing the free chunk
+	 * that follows it, so that its body is at least `bodySize` bytes.  The
+	 * part of the free chunk that is not needed is returned to the bins if it
+	 * is large enough to be a chunk.  The growth in the chunk size is charged
+	 * to `quota`.
+	 *
+	 * Returns true on success.  Returns false, and leaves everything
+	 * unmodified, if the next chunk is in use (including chunks in quarantine)
+	 * or too small, or if `quota` is insufficient.
+	 */
+	bool mspace_extend(MChunkHeader &p, size_t bodySize, size_t &quota)
+	{
+		size_t nb   = bodySize + sizeof(MChunkHeader);
+		size_t size = p.size_get();
+		Debug::Assert(p.is_in_use(), "Extending free chunk {}", &p);
+		Debug::Assert(nb > size, "Extending chunk of {} bytes to {}", size, nb);
+
+		MChunkHeader *next = p.cell_next();
+		if (next->is_in_use())
+		{
+			return false;
+		}
+		size_t nextSize = next->size_get();
+		if (size + nextSize < nb)
+		{
+			return false;
+		}
+		size_t rsize   = size + nextSize - nb;
+		size_t newSize = (rsize >= MinChunkSize) ? nb : size + nextSize;
+		if (newSize - size > quota)
+		{
+			return false;
+		}
+
+		// Absorb the whole of the next chunk.
+		unlink_chunk(MChunk::from_header(next), nextSize);
+		ds::linked_list::unsafe_remove_link(&p, next);
+		next->clear();
+		// next is no longer a header. Clear the shadow bit.
+		revoker.shadow_paint_single(CHERI::Capability{next}.address(), false);
+		p.mark_in_use();
+
+		// Give back the tail, if it is big enough to be a chunk.
+		if (rsize >= MinChunkSize)
+		{
+			auto r = p.split(nb);
+			r->mark_free();
+			insert_chunk(r, rsize);
+		}
+
+		heapFreeSize -= newSize - size;
+		quota -= newSize - size;
+		ok_in_use_chunk(&p);
+		return true;
+	}
+
+	/**
+	 * Copy the valid hazard pointers into `hazardSnapshot`, sorted by base
+	 * address.  This reads each thread's hazard slots once, rather than once
+	 * per object checked, and lets `hazard_pointer_check` binary search the
+	 * result.
 	 *
 	 * This must be called in between `hazard_list_begin` and the guard going
-	 * out of scope.
+	 * out of scope.  Threads cannot successfully publish new hazard pointers
+	 * until the guard is released.  They may clear them, which makes the
+	 * snapshot conservative but not unsafe.
 	 */
-	bool hazard_pointer_check(Capability<void> allocation)
+	void hazard_pointers_snapshot()
 	{
 		// It is now safe to walk the hazard list.
 		Capability<void *> hazards =
 		  const_cast<void **>(SHARED_OBJECT_WITH_PERMISSIONS(
 		    void *, allocator_hazard_pointers, true, false, true, false));
 		size_t pointers = hazards.length() / sizeof(void *);
+		size_t count    = 0;
 		for (size_t i = 0; i < pointers; i++)
 		{
-			Capability hazardPointer{hazards[i]};
-			if (hazardPointer.is_valid() &&
-			    hazardPointer.is_subset_of(allocation))
+			Capability<void> hazardPointer{hazards[i]};
+			if (!hazardPointer.is_valid())
+			{
+				continue;
+			}
+			// Insertion sort.  Its cost grows with the square of the number
+			// of live hazard pointers, not the number of slots.  Most slots
+			// are empty at any given time, even with the maximum of eight per
+			// thread, so only a handful of entries are ever sorted.
+			size_t insert = count++;
+			while ((insert > 0) &&
+			       (Capability{hazardSnapshot[insert - 1]}.base() >
+			        hazardPointer.base()))
+			{
+				hazardSnapshot[insert] = hazardSnapshot[insert - 1];
+				insert--;
+			}
+			hazardSnapshot[insert] = hazardPointer;
+		}
+		hazardSnapshotOccupancy = count;
+	}
+
+	/**
+	 * Check whether `allocation` is in the hazard list.  Returns true if it is.
+	 *
+	 * This must be called in between `hazard_list_begin` and the guard going
+	 * out of scope, after `hazard_pointers_snapshot` has been called with the
+	 * same guard held.
+	 */
+	bool hazard_pointer_check(Capability<void> allocation)
+	{
+		// Find the first hazard pointer whose base is not below the base of
+		// the allocation.  Any hazard pointer that is a subset of the
+		// allocation must be at or after this point.
+		ptraddr_t base  = allocation.base();
+		ptraddr_t top   = allocation.top();
+		size_t    lower = 0;
+		size_t    upper = hazardSnapshotOccupancy;
+		while (lower < upper)
+		{
+			size_t middle = lower + ((upper - lower) / 2);
+			if (Capability{hazardSnapshot[middle]}.base() < base)
+			{
+				lower = middle + 1;
+			}
+			else
+			{
+				upper = middle;
+			}
+		}
+		for (size_t i = lower; i < hazardSnapshotOccupancy; i++)
+		{
+			Capability hazardPointer{hazardSnapshot[i]};
+			if (hazardPointer.base() > top)
+			{
+				break;
+			}
+			if (hazardPointer.is_subset_of(allocation))
 			{
-				Debug::log("Found hazard pointer for {} (thread: {})",
-				           allocation,
-				           ((i / 2) + 1));
+				Debug::log("Found hazard pointer for {}", allocation);
 				return true;
 			}
 		}
@@ -1296,7 +1556,9 @@ class MState
 
 	/**
 	 * Recheck all of the pointers in the hazard quarantine and free any that
-	 * are no longer on active hazard lists.
+	 * are no longer on active hazard lists.  This takes a new snapshot of the
+	 * hazard pointers, which subsequent calls to `hazard_pointer_check` with
+	 * the same guard held will use.
 	 *
 	 * This must be called in between `hazard_list_begin` and the guard that
 	 * `hazard_list_begin` returns going out of scope.
@@ -1305,6 +1567,7 @@ class MState
 	 */
 	bool hazard_pointers_recheck(Capability<void> skip = nullptr)
 	{
+		hazard_pointers_snapshot();
 		size_t insert            = 0;
 		bool   foundSkippedValue = false;
 		for (size_t i = 0; i < hazardQuarantineOccupancy; i++)
@@ -1328,13 +1591,76 @@ class MState
 				auto chunk     = MChunkHeader::from_body(heap);
 				// We know this isn't in the hazard lists (we just checked!) so
 				// free it without doing any hazard pointer checks checks.
-				mspace_free(*chunk, ptr.length(), true);
+				mspace_free(*chunk, ptr.length(), HazardCheck::Skip);
 			}
 		}
 		hazardQuarantineOccupancy = insert;
 		return foundSkippedValue;
 	}
 
+	/**
+	 * Helper for `mspace_free`.  This must be called in between
+	 * `hazard_list_begin` and the guard going out of scope.
+	 *
+	 * If `bounded` is on a live hazard list, captures it in the hazard
+	 * quarantine and returns false.  If `bounded` is not a valid capability,
+	 * returns false.  Otherwise, paints the shadow bits for `chunk` and
+	 * returns true to indicate that the caller should continue freeing it.
+	 */
+	bool hazard_check_and_paint(MChunkHeader &chunk, Capability<void> bounded)
+	{
+		// If this object is on a live hazard list, capture it and don't free
+		// yet.
+		if (hazard_pointer_check(bounded))
+		{
+			hazard_quarantine_add(bounded);
+			return false;
+		}
+		if (!bounded.is_valid())
+		{
+			return false;
+		}
+
+		/*
+		 * Paint the shadow bitmap with the hazard epoch odd.  This must
+		 * happen before we increment the epoch so that any threads that saw
+		 * that they are waiting for us to walk the epoch list will block
+		 * until we're done.
+		 *
+		 * It must also happen before zeroing because the allocator is
+		 * running with interrupts enabled.  Were we to zero and then paint,
+		 * there would be a window in which preemption could allow a store
+		 * through a copy of the user capability (or its progeny) that undid
+		 * our work of zeroing!
+		 */
+		revoker.shadow_paint_range<true>(chunk.body().address(),
+		                                 chunk.cell_next());
+		return true;
+	}
+
+	/**
+	 * How `mspace_free` should treat the hazard list.
+	 */
+	enum class HazardCheck
+	{
+		/**
+		 * Acquire the hazard list, recheck the hazard quarantine and then
+		 * check whether the object being freed is on a hazard list.
+		 */
+		Full,
+		/**
+		 * The caller has already called `hazard_list_begin` and
+		 * `hazard_pointers_recheck` and still holds the guard, for example
+		 * because it is freeing several objects in a row.  Check only whether
+		 * the object being freed is on a hazard list.
+		 */
+		ListHeld,
+		/**
+		 * The caller knows that the object is not on any hazard list.
+		 */
+		Skip,
+	};
+
 	/**
 	 * Free a chunk.  The `bodySize` parameter specifies the size of the
 	 * allocated space that must be zeroed.  This must be calculated by the
@@ -1342,7 +1668,7 @@ class MState
 	 */
 	int mspace_free(MChunkHeader &chunk,
 	                size_t        bodySize,
-	                bool          skipHazardCheck = false)
+	                HazardCheck   hazardCheck = HazardCheck::Full)
 	{
 		// Expand the bounds of the freed object to the whole heap and set the
 		// address that we're looking at to the base of the requested
@@ -1351,9 +1677,9 @@ class MState
 
 		bool isDoubleFree = false;
 
-		if (__predict_false(skipHazardCheck))
+		if (__predict_false(hazardCheck == HazardCheck::Skip))
 		{
-			// Paint before zeroing, see comment on the `else` code path.
+			// Paint before zeroing, see comment in `hazard_check_and_paint`.
 			revoker.shadow_paint_range<true>(mem.address(), chunk.cell_next());
 		}
 		else
@@ -1361,42 +1687,40 @@ class MState
 			Capability bounded{mem};
 			bounded.bounds() = bodySize;
 
-			// Set the hazard epoch to odd so that no other threads can
-			// successfully add things to the hazard list until we're done.
-			// The epoch will be incremented to even at the end of this scope.
-			auto guard = hazard_list_begin();
-
-			// Free any objects whose lifetimes were extended by hazards,
-			// skipping freeing this one to avoid a double free.
-			// Track if we're freeing an object that has already been freed but
-			// is kept alive by a hazard pointer.
-			isDoubleFree = hazard_pointers_recheck(bounded);
-
-			// If this object is on a live hazard list, capture it and don't
-			// free yet.
-			if (hazard_pointer_check(bounded))
+			if (hazardCheck == HazardCheck::ListHeld)
 			{
-				hazard_quarantine_add(bounded);
-				return isDoubleFree ? -EINVAL : 0;
+				// The hazard quarantine has just been rechecked, so anything
+				// still in it is on a live hazard list and will be freed
+				// later.  Freeing it again now would be a double free.
+				if (hazard_quarantine_contains(bounded))
+				{
+					return -EINVAL;
+				}
+				if (!hazard_check_and_paint(chunk, bounded))
+				{
+					return bounded.is_valid() ? 0 : -EINVAL;
+				}
 			}
-			if (!bounded.is_valid())
+			else
 			{
-				return -EINVAL;
+				// Set the hazard epoch to odd so that no other threads can
+				// successfully add things to the hazard list until we're done.
+				// The epoch will be incremented to even at the end of this
+				// scope.
+				auto guard = hazard_list_begin();
+
+				// Free any objects whose lifetimes were extended by hazards,
+				// skipping freeing this one to avoid a double free.
+				// Track if we're freeing an object that has already been freed
+				// but is kept alive by a hazard pointer.
+				isDoubleFree = hazard_pointers_recheck(bounded);
+
+				if (!hazard_check_and_paint(chunk, bounded))
+				{
+					return (isDoubleFree || !bounded.is_valid()) ? -EINVAL
+					                                             : 0;
+				}
 			}
-
-			/*
-			 * Paint the shadow bitmap with the hazard epoch odd.  This must
-			 * happen before we increment the epoch so that any threads that saw
-			 * that they are waiting for us to walk the epoch list will block
-			 * until we're done.
-			 *
-			 * It must also happen before zeroing because the allocator is
-			 * running with interrupts enabled.  Were we to zero and then paint,
-			 * there would be a window in which preemption could allow a store
-			 * through a copy of the user capability (or its progeny) that undid
-			 * our work of zeroing!
-			 */
-			revoker.shadow_paint_range<true>(mem.address(), chunk.cell_next());
 		}
 
 		/*
@@ -1424,16 +1748,73 @@ class MState
 		heapQuarantineSize += chunk.size_get();
 
 		/*
-		 * Perhaps there has been some progress on revocation.  Dequeue 3 times.
-		 * 3 is chosen randomly. At least 2 is needed for easy argument that the
-		 * allocator stays ahead of its quarantine.
+		 * Perhaps there has been some progress on revocation.  Dequeue at
+		 * least 3 times.  3 is chosen randomly. At least 2 is needed for easy
+		 * argument that the allocator stays ahead of its quarantine.
 		 */
-		mspace_qtbin_deqn(3);
+		mspace_qtbin_deqn(quarantine_drain_budget(3));
 		mspace_bg_revoker_kick();
 
 		return isDoubleFree ? -EINVAL : 0;
 	}
 
+#if ALLOCATOR_SEALED_CACHE
+	/**
+	 * Retire an in-use chunk, for a cache that will reuse it once revocation
+	 * has finished, rather than freeing it.  As with `mspace_free`, this
+	 * paints the shadow bits of the body and then zeroes `bodySize` bytes of
+	 * it, but the chunk stays in use and does not enter quarantine.  `epoch`
+	 * is set to the revocation epoch that must finish before the chunk is
+	 * reused.
+	 *
+	 * Returns false, leaving the chunk untouched, if it is on a hazard list.
+	 * The caller should then free it with `mspace_free`.
+	 */
+	bool mspace_retire(MChunkHeader &chunk, size_t bodySize, uint32_t &epoch)
+	{
+		Capability bounded{chunk.body()};
+		bounded.bounds() = bodySize;
+		{
+			auto guard = hazard_list_begin();
+			hazard_pointers_recheck();
+			if (hazard_pointer_check(bounded))
+			{
+				return false;
+			}
+			// Paint before zeroing, see comment in `hazard_check_and_paint`.
+			revoker.shadow_paint_range<true>(chunk.body().address(),
+			                                 chunk.cell_next());
+		}
+		epoch = revoker.system_epoch_get();
+		capaligned_zero(chunk.body(), bodySize);
+		epoch += epoch & 1;
+		return true;
+	}
+
+	/**
+	 * Free a chunk that was retired with `mspace_retire` for `epoch`.  If
+	 * revocation has finished for that epoch, the chunk returns to the free
+	 * lists immediately, otherwise it is placed in quarantine.
+	 */
+	void mspace_retired_free(MChunkHeader &chunk, uint32_t epoch)
+	{
+		chunk.ownerID        = 0;
+		chunk.isSealedObject = false;
+		if (revoker.has_revocation_finished_for_epoch(epoch))
+		{
+			heapFreeSize += chunk.size_get();
+			revoker.shadow_paint_range<false>(chunk.body().address(),
+			                                  chunk.cell_next());
+			mspace_free_internal(&chunk);
+			return;
+		}
+		epoch = revoker.system_epoch_get();
+		epoch += epoch & 1;
+		quarantine_pending_push(epoch, &chunk);
+		heapQuarantineSize += chunk.size_get();
+	}
+#endif
+
 	/**
 	 * Given a pointer that is probably in an allocation, try to find the start
 	 * of that allocation.  Returns the header if this is a valid pointer into
@@ -1461,9 +1842,28 @@ class MState
 			{
 				return nullptr;
 			}
-			while (!revoker.shadow_bit_get(address) && (address > base))
+			while (true)
 			{
-				address -= MallocAlignment;
+				while (!revoker.shadow_bit_get(address) && (address > base))
+				{
+					address -= MallocAlignment;
+				}
+				// A freed pool object stays painted until it is reused, but
+				// the pool's chunk is still live.  The last granule of a
+				// freed pool object is zero and no chunk header has a zero
+				// size, so skip over the object to keep looking for the
+				// pool's header.
+				CHERI::Capability<MChunkHeader> granule{
+				  heapStart.cast<MChunkHeader>()};
+				granule.address() = address;
+				if ((granule->currSize != 0) || (address == base))
+				{
+					break;
+				}
+				while (revoker.shadow_bit_get(address) && (address > base))
+				{
+					address -= MallocAlignment;
+				}
 			}
 		}
 		CHERI::Capability<MChunkHeader> header{heapStart.cast<MChunkHeader>()};
@@ -1483,7 +1883,42 @@ class MState
 	__always_inline bool quarantine_dequeue()
 	{
 		// 4 chosen by fair die roll.
-		return mspace_qtbin_deqn(4) > 0;
+		return mspace_qtbin_deqn(quarantine_drain_budget(4)) > 0;
+	}
+
+	/**
+	 * Returns the size, including the header, of the largest chunk in the
+	 * free bins, or zero if they are empty.  Chunks held in slab caches are
+	 * not considered.
+	 *
+	 * This looks only at the largest non-empty bin.  Within a tree bin, any
+	 * chunk in a node's `child[1]` subtree is larger than every chunk in its
+	 * `child[0]` subtree, so the largest chunk is on the path that prefers
+	 * `child[1]` and this visits at most one node per level of the trie.
+	 */
+	size_t largest_free_chunk()
+	{
+		if (treemap != 0)
+		{
+			BIndex i =
+			  utils::bytes2bits(sizeof(Binmap)) - 1 - __builtin_clz(treemap);
+			size_t  largest = 0;
+			TChunk *t       = *treebin_at(i);
+			while (t != nullptr)
+			{
+				largest =
+				  std::max(largest, MChunkHeader::from_body(t)->size_get());
+				t = (t->child[1] != nullptr) ? t->child[1] : t->child[0];
+			}
+			return largest;
+		}
+		if (smallmap != 0)
+		{
+			BIndex i =
+			  utils::bytes2bits(sizeof(Binmap)) - 1 - __builtin_clz(smallmap);
+			return small_index2size(i);
+		}
+		return 0;
 	}
 
 	private:
@@ -1914,6 +2349,7 @@ class MState
 		 * generate redundant stores.
 		 */
 		bin->append_emplace(&(new (p->body()) MChunk())->ring);
+		smallbinChunkCounts[i]++;
 	}
 
 	/// Unlink a chunk from a smallbin.
@@ -1960,6 +2396,7 @@ class MState
 			corruption_error_action();
 		}
 
+		smallbinChunkCounts[i]--;
 		p->metadata_clear();
 	}
 
@@ -1982,6 +2419,7 @@ class MState
 		{
 			smallmap_clear(i);
 		}
+		smallbinChunkCounts[i]--;
 
 		p->metadata_clear();
 
@@ -2005,6 +2443,7 @@ class MState
 		TChunk **head;
 		BIndex   i = compute_tree_index(s);
 		head       = treebin_at(i);
+		treebinChunkCounts[i]++;
 
 		if (!is_treemap_marked(i))
 		{
@@ -2077,6 +2516,7 @@ class MState
 	{
 		TChunk *xp = x->parent;
 		TChunk *r;
+		treebinChunkCounts[x->index]--;
 		if (!ds::linked_list::is_singleton(&x->mchunk.ring))
 		{
 			TChunk *f = TChunk::from_ring(x->mchunk.ring.cell_next());
@@ -2532,6 +2972,44 @@ class MState
 		return 1;
 	}
 
+	/**
+	 * Returns the number of chunks to try to move out of quarantine, given
+	 * the number, `base`, that the caller would use with no heap pressure.
+	 *
+	 * With the adaptive drain policy, the budget grows with the ratio of
+	 * quarantined to free memory, up to `QuarantineDrainMax`, but only when
+	 * some quarantined chunks have finished revocation.  If none have then
+	 * draining cannot make progress and so the budget is not scaled.  With
+	 * the fixed policy, this returns `base`.
+	 */
+	size_t quarantine_drain_budget(size_t base)
+	{
+#if ALLOCATOR_ADAPTIVE_DRAIN
+		if (heapQuarantineSize == 0)
+		{
+			return base;
+		}
+		// Pick up any pending ring whose epoch has now passed.
+		auto quarantine = quarantine_finished_get();
+		if (quarantine->is_empty())
+		{
+			quarantine_pending_to_finished();
+			if (quarantine->is_empty())
+			{
+				return base;
+			}
+		}
+		// Add `base` for each quarter of the free space that the quarantine
+		// occupies, so that a quarantine as large as the free space is
+		// drained five times as quickly.
+		size_t quarter = std::max(heapFreeSize / 4, MinChunkSize);
+		size_t scale   = 1 + (heapQuarantineSize / quarter);
+		return std::min(base * scale, std::max(base, QuarantineDrainMax));
+#else
+		return base;
+#endif
+	}
+
 	/**
 	 * @brief Try to dequeue the quarantine list multiple times.
 	 *
@@ -2579,7 +3057,16 @@ class MState
 			revoker.shadow_paint_range<false>(foreHeader->body().address(),
 			                                  foreHeader->cell_next());
 
-			mspace_free_internal(foreHeader);
+#if ALLOCATOR_SLAB
+			/*
+			 * Small chunks go back onto their slab class, if there is room,
+			 * rather than being coalesced.
+			 */
+			if (!slab_cache_push(foreHeader))
+#endif
+			{
+				mspace_free_internal(foreHeader);
+			}
 			dequeued++;
 		}
 		return dequeued;
@@ -2621,13 +3108,50 @@ class MState
 	/**
 	 * This is the only function that takes memory from the free list. All other
 	 * wrappers that take memory must call this in the end.
+	 *
+	 * Callers that have already moved nodes from the quarantine for this
+	 * request pass false as `dequeueQuarantine`.
 	 */
-	MChunkHeader *mspace_malloc_internal(size_t bytes)
+	MChunkHeader *mspace_malloc_internal(size_t bytes,
+	                                     bool   dequeueQuarantine = true)
 	{
-		size_t nb;
-
 		/* Move O(1) nodes from quarantine, if any are available */
-		quarantine_dequeue();
+		if (dequeueQuarantine)
+		{
+			quarantine_dequeue();
+		}
+
+		MChunkHeader *p = mspace_malloc_bins(bytes);
+#if ALLOCATOR_SLAB
+		/*
+		 * The slab caches may be holding memory that would satisfy this
+		 * request once coalesced.  Give it back to the bins and try again.
+		 */
+		if ((p == nullptr) && slab_cache_flush())
+		{
+			p = mspace_malloc_bins(bytes);
+		}
+#endif
+		if (p == nullptr)
+		{
+			/*
+			 * Exhausted all allocation options. Force start a revocation or
+			 * continue with synchronous revocation.
+			 */
+			mspace_bg_revoker_kick<true>();
+		}
+		return p;
+	}
+
+	/**
+	 * Take a chunk big enough for `bytes` from the small bins or the trees.
+	 * Returns nullptr if there is no suitable free chunk.
+	 *
+	 * The chunk holding the returned memory has had its linkages cleared.
+	 */
+	MChunkHeader *mspace_malloc_bins(size_t bytes)
+	{
+		size_t nb;
 
 		if (bytes <= MaxSmallRequest)
 		{
@@ -2682,17 +3206,159 @@ class MState
 			}
 		}
 
+		return nullptr;
+	}
+
+#if ALLOCATOR_SLAB
+	/**
+	 * Put a chunk that has left quarantine onto its slab class.  The chunk
+	 * must be marked in use, have clear shadow bits and a zeroed body.
+	 *
+	 * Returns false, leaving the chunk untouched, if the chunk is not a slab
+	 * size or its class is already full.
+	 */
+	bool slab_cache_push(MChunkHeader *p)
+	{
+		size_t size = p->size_get();
+		if (!is_slab_size(size))
+		{
+			return false;
+		}
+		BIndex i = slab_index(size);
+		if (slabCacheCounts[i] >= SlabClassLimit)
+		{
+			return false;
+		}
+		ok_in_use_chunk(p);
+		p->set_owner(MChunkHeader::SlabCachedOwnerID);
+		p->isSealedObject = false;
+		slab_cache_at(i)->append_emplace(&(new (p->body()) MChunk())->ring);
+		slabCacheCounts[i]++;
+		return true;
+	}
+
+	/**
+	 * Remove the first chunk from slab class i, which must not be empty.
+	 *
+	 * The returned chunk is still marked in use and has had its linkages
+	 * cleared.
+	 */
+	MChunkHeader *slab_cache_take(BIndex i)
+	{
+		auto    cache = slab_cache_at(i);
+		MChunk *p     = MChunk::from_ring(cache->unsafe_take_first());
+		slabCacheCounts[i]--;
+		p->metadata_clear();
+		auto header = MChunkHeader::from_body(p);
+		header->set_owner(0);
+		return header;
+	}
+
+	/**
+	 * Refill the empty slab class i, which holds chunks of nb bytes, by
+	 * carving `SlabPageObjects` chunks out of a single chunk from the bins.
+	 * Every object keeps its own header, so bounds, `heap_free`, claims and
+	 * the shadow bitmap all treat them exactly like any other allocation.
+	 *
+	 * Returns false if the bins cannot provide the space.
+	 */
+	bool slab_refill(BIndex i, size_t nb)
+	{
+		MChunkHeader *page =
+		  mspace_malloc_bins(SlabPageObjects * nb - sizeof(MChunkHeader));
+		if (page == nullptr)
+		{
+			return false;
+		}
 		/*
-		 * Exhausted all allocation options. Force start a revocation or
-		 * continue with synchronous revocation.
+		 * The bins may have given us slightly more than we asked for, if the
+		 * remainder was too small to split off.  Any such excess ends up in
+		 * the last chunk.
 		 */
-		mspace_bg_revoker_kick<true>();
-		return nullptr;
+		size_t remaining = page->size_get();
+		while (remaining >= 2 * nb)
+		{
+			MChunkHeader *next = page->split(nb);
+			slab_cache_push(page);
+			page = next;
+			remaining -= nb;
+		}
+		// This chunk came straight from the bins and was never counted as
+		// allocated, so do not adjust heapFreeSize for either path.
+		if (!slab_cache_push(page))
+		{
+			mspace_free_internal(page);
+		}
+		return slabCacheCounts[i] > 0;
 	}
 
+	/**
+	 * Try to satisfy a request for `bytes` bytes from the slab caches.
+	 * Returns nullptr if this is not a slab-sized request or if the class is
+	 * empty and cannot be refilled.
+	 *
+	 * The chunk holding the returned memory has had its linkages cleared.
+	 */
+	MChunkHeader *slab_malloc(size_t bytes)
+	{
+		size_t nb = (bytes < MinRequest) ? MinChunkSize : pad_request(bytes);
+		if (!is_slab_size(nb))
+		{
+			return nullptr;
+		}
+		BIndex i = slab_index(nb);
+		if ((slabCacheCounts[i] == 0) && !slab_refill(i, nb))
+		{
+			return nullptr;
+		}
+		auto p = slab_cache_take(i);
+		ok_malloced_chunk(p, nb);
+		return p;
+	}
+
+	/**
+	 * Return every chunk in the slab caches to the bins, coalescing them with
+	 * their free neighbours.
+	 *
+	 * Returns true if any chunks were returned.
+	 */
+	bool slab_cache_flush()
+	{
+		bool flushed = false;
+		for (BIndex i = 0; i < NSlabClasses; ++i)
+		{
+			while (slabCacheCounts[i] > 0)
+			{
+				// Cached chunks are already counted in heapFreeSize.
+				mspace_free_internal(slab_cache_take(i));
+				flushed = true;
+			}
+		}
+		return flushed;
+	}
+#endif
+
 	__always_inline void *mspace_malloc(size_t bytes)
 	{
-		auto p = mspace_malloc_internal(bytes);
+		bool dequeueQuarantine = true;
+#if ALLOCATOR_SLAB
+		/*
+		 * Small requests are served in O(1) from the slab caches.  Keep the
+		 * quarantine moving, as the general path does, because that is also
+		 * what refills the caches.  If the caches miss, the general path does
+		 * not need to dequeue again.
+		 */
+		if (bytes <= SlabMaxChunkSize - sizeof(MChunkHeader))
+		{
+			quarantine_dequeue();
+			if (auto p = slab_malloc(bytes))
+			{
+				return mspace_malloc_success(p);
+			}
+			dequeueQuarantine = false;
+		}
+#endif
+		auto p = mspace_malloc_internal(bytes, dequeueQuarantine);
 		if (p != nullptr)
 		{
 			return mspace_malloc_success(p);
@@ -2871,6 +3537,13 @@ class MState
 					}
 				}
 			}
+#	if ALLOCATOR_SLAB
+			else if (header->ownerID == MChunkHeader::SlabCachedOwnerID)
+			{
+				RenderDebug::log("   slab cached");
+				measuredFree += header->size_get();
+			}
+#	endif
 			else
 			{
 				measuredAllocated += header->size_get();
@@ -2961,4 +3634,67 @@ class MState
 		}
 	}
 #endif
+
+#if ALLOCATOR_SNAPSHOT
+	public:
+	/**
+	 * The state of a chunk, as reported by `snapshot`.  These values are part
+	 * of the snapshot format that `scripts/heap_snapshot.py` decodes.
+	 */
+	enum class SnapshotState : uint8_t
+	{
+		Free        = 0,
+		InUse       = 1,
+		Quarantined = 2,
+		/// Held in the slab cache or the sealed-object cache.
+		Cached = 3,
+	};
+
+	/**
+	 * Call `visit` with the address, size, state, owner ID, and sealed flag of
+	 * each chunk in this memory space, in address order.  Quarantined chunks
+	 * report the owner that freed them.  The caller must hold the allocator
+	 * lock.
+	 */
+	template<typename Visitor>
+	void snapshot(Visitor &&visit)
+	{
+		auto header =
+		  static_cast<MChunkHeader *>(static_cast<void *>(heapStart));
+		ptraddr_t address;
+		while ((address = CHERI::Capability{header}.address()) !=
+		       heapStart.top())
+		{
+			SnapshotState state = SnapshotState::Free;
+			uint16_t      owner = 0;
+			if (header->is_in_use())
+			{
+				owner = header->owner();
+				state = SnapshotState::InUse;
+				if ((owner == MChunkHeader::SlabCachedOwnerID) ||
+				    (owner == MChunkHeader::SealedCachedOwnerID))
+				{
+					state = SnapshotState::Cached;
+				}
+				else if constexpr (!std::is_same_v<
+				                     Revocation::Revoker,
+				                     Revocation::NoTemporalSafety>)
+				{
+					// Freed chunks keep their in-use header while they are in
+					// quarantine, but their bodies are painted.
+					if (revoker.shadow_bit_get(header->body().address()))
+					{
+						state = SnapshotState::Quarantined;
+					}
+				}
+			}
+			visit(address,
+			      header->size_get(),
+			      state,
+			      owner,
+			      header->isSealedObject);
+			header = header->cell_next();
+		}
+	}
+#endif
 };
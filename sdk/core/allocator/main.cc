@@ -46,6 +46,33 @@ namespace
 		size_t quota;
 		/// A unique identifier for this pool.
 		uint16_t identifier;
+		/// The number of chunks recorded in `ownedChunks`.
+		uint16_t ownedChunkCount;
+		/**
+		 * Index of the chunks that this capability owns or holds claims on.
+		 * See `owned_chunk_add`.  Null until the first allocation.
+		 */
+		uint16_t *ownedChunks;
+		/// The number of slots in `ownedChunks` that are not empty.
+		uint16_t ownedChunkSlotsUsed;
+		/**
+		 * Log2 of the number of slots in `ownedChunks`, or zero if there is
+		 * no table.  Use `owned_chunk_capacity` to read this.
+		 */
+		uint8_t ownedChunkCapacityLog2;
+		/**
+		 * Set if `ownedChunks` could not be grown and so does not record
+		 * every chunk that this capability owns.  Cleared when
+		 * `heap_free_all` rebuilds the index.
+		 */
+		bool ownedChunksIncomplete : 1;
+		/**
+		 * Set while `heap_free_all` iterates over `ownedChunks`, so that
+		 * removing entries does not shrink the table.
+		 */
+		bool ownedChunksPinned : 1;
+		/// The smallest value that `quota` has had, reported by `heap_stats`.
+		size_t quotaLowWater;
 	};
 
 	static_assert(sizeof(PrivateAllocatorCapabilityState) <=
@@ -56,6 +83,37 @@ namespace
 	// the global memory space
 	MState *gm;
 
+#ifdef CHERIOT_HEAP_REGIONS
+#	define CHERIOT_HEAP_REGION(name, preferredMaxAllocation) +1
+	/**
+	 * The number of heap regions, including the main heap.
+	 */
+	constexpr size_t HeapRegionCount = 1 CHERIOT_HEAP_REGIONS;
+#	undef CHERIOT_HEAP_REGION
+#else
+	constexpr size_t HeapRegionCount = 1;
+#endif
+
+	/**
+	 * A region of memory that the allocator manages as a separate memory
+	 * space.  The first is the main heap, the others are the additional
+	 * regions listed in the `heap_regions` property of the board description.
+	 */
+	struct HeapRegion
+	{
+		/// The memory space for this region, or null if it is not in use.
+		MState *state;
+		/**
+		 * Allocations of up to this many bytes try this region before the
+		 * main heap.  Larger allocations use it only if the main heap cannot
+		 * satisfy them.
+		 */
+		size_t preferredMaxAllocation;
+	};
+
+	/// The heap regions.  The first is always the main heap, `gm`.
+	HeapRegion heapRegions[HeapRegionCount];
+
 	/**
 	 * A global lock for the allocator.  This is acquired in public API
 	 * functions, all internal functions should assume that it is held. If
@@ -64,6 +122,45 @@ namespace
 	 */
 	FlagLockPriorityInherited lock;
 
+	/**
+	 * Record of a thread blocked in `malloc_internal` until enough memory is
+	 * freed for its allocation to plausibly succeed.  There is one of these
+	 * for each thread, indexed by thread ID, carved from the front of the
+	 * heap by `mstate_init` so that they are available when the heap is
+	 * full.
+	 */
+	struct AllocationWaiter
+	{
+		/**
+		 * The allocator capability whose quota this thread is waiting for, or
+		 * null if it is waiting for space in the heap.
+		 */
+		PrivateAllocatorCapabilityState *capability;
+		/**
+		 * The amount of quota, or of free and quarantined heap space, that
+		 * this thread's allocation needs.
+		 */
+		size_t neededSize;
+		/**
+		 * Futex word that the thread sleeps on.  This is non-zero while the
+		 * thread is waiting.  Whichever of the waiting thread and a waker
+		 * exchanges it for zero removes the thread from the waiter count.
+		 */
+		cheriot::atomic<uint32_t> futex;
+	};
+
+	/// Per-thread waiter records, see `AllocationWaiter`.
+	AllocationWaiter *allocationWaiters;
+
+	/// The number of entries in `allocationWaiters`.
+	size_t allocationWaiterCount;
+
+	/**
+	 * The number of threads currently waiting in `allocationWaiters`, so that
+	 * frees can skip looking at them in the common case that there are none.
+	 */
+	cheriot::atomic<uint32_t> allocationWaitersBlocked;
+
 	/**
 	 * @brief Take a memory region and initialise a memory space for it. The
 	 * MState structure will be placed at the beginning and the rest used as the
@@ -71,9 +168,11 @@ namespace
 	 *
 	 * @param tbase the capability to the region
 	 * @param tsize size of the region
+	 * @param isMainHeap true if this is the main heap, which also holds the
+	 *        allocation waiter records
 	 * @return pointer to the MState if can be initialised, nullptr otherwise.
 	 */
-	MState *mstate_init(Capability<void> tbase, size_t tsize)
+	MState *mstate_init(Capability<void> tbase, size_t tsize, bool isMainHeap)
 	{
 		if (!is_aligned(tbase) || !is_aligned(tsize))
 		{
@@ -104,26 +203,91 @@ namespace
 		      void *, allocator_hazard_pointers, true, false, true, false)}
 		    .length();
 
+		// The hazard quarantine and the hazard snapshot are each the same
+		// size as the hazard pointer array.
+		size_t hazardSpace = 2 * hazardQuarantineSize;
+
+		uint16_t threads = thread_count();
+		if (threads == UINT16_MAX)
+		{
+			return nullptr;
+		}
+		size_t waiterSize =
+		  isMainHeap ? (threads * sizeof(AllocationWaiter) + MallocAlignMask) &
+		                 ~MallocAlignMask
+		             : 0;
+		size_t carveSize = hazardSpace + waiterSize;
+
 		m.bounds()            = sizeof(*m);
 		m->heapStart          = tbase;
 		m->heapStart.bounds() = tsize;
-		m->heapStart.address() += msize + hazardQuarantineSize;
+		m->heapStart.address() += msize + carveSize;
 		m->init_bins();
 
 		// Carve off the front of the heap space to use for the hazard
-		// quarantine.
+		// quarantine and snapshot.
 		Capability hazardQuarantine = tbase;
 		hazardQuarantine.address() += msize;
 		hazardQuarantine.bounds() = hazardQuarantineSize;
 		m->hazardQuarantine       = hazardQuarantine.cast<void *>();
+		Capability hazardSnapshot = tbase;
+		hazardSnapshot.address() += msize + hazardQuarantineSize;
+		hazardSnapshot.bounds() = hazardQuarantineSize;
+		m->hazardSnapshot       = hazardSnapshot.cast<void *>();
+
+		// Followed, in the main heap, by the allocation waiter records.  The
+		// heap is zeroed, so no thread is initially waiting.
+		if (isMainHeap)
+		{
+			Capability waiters = tbase;
+			waiters.address() += msize + hazardSpace;
+			waiters.bounds()      = waiterSize;
+			allocationWaiters     = waiters.cast<AllocationWaiter>();
+			allocationWaiterCount = threads;
+		}
 
 		m->mspace_firstchunk_add(
-		  ds::pointer::offset<void>(tbase.get(), msize + hazardQuarantineSize),
-		  tsize - msize - hazardQuarantineSize);
+		  ds::pointer::offset<void>(tbase.get(), msize + carveSize),
+		  tsize - msize - carveSize);
 
 		return m;
 	}
 
+	/**
+	 * Set up the additional heap region at `index` in `heapRegions`.
+	 *
+	 * Claims and the owned-chunk index identify chunks by 16-bit shifted
+	 * offsets from the start of the main heap, so a region that extends
+	 * beyond the range of those offsets cannot be used.  The build system
+	 * rejects such regions, using a conservative bound, so this is only a
+	 * fallback.
+	 */
+	void heap_region_init(size_t      index,
+	                      const void *memory,
+	                      size_t      preferredMaxAllocation)
+	{
+		Capability region{const_cast<void *>(memory)};
+		ptraddr_t  encodableTop =
+		  gm->heapStart.address() + (size_t(UINT16_MAX) << MallocAlignShift);
+		if (region.top() > encodableTop)
+		{
+			Debug::log<DebugLevel::Warning>(
+			  "Heap region {} is too far from the main heap to be used",
+			  region);
+			return;
+		}
+		// The loader zeroes only the main heap.
+		memset(region.get(), 0, region.bounds());
+		MState *state = mstate_init(region, region.bounds(), false);
+		if (state == nullptr)
+		{
+			Debug::log<DebugLevel::Warning>("Heap region {} cannot be used",
+			                                region);
+			return;
+		}
+		heapRegions[index] = {state, preferredMaxAllocation};
+	}
+
 	void check_gm()
 	{
 		if (gm == nullptr)
@@ -137,16 +301,606 @@ namespace
 			                                   /*loadMutable*/ true));
 
 			revoker.init();
-			gm = mstate_init(heap, heap.bounds());
+			gm = mstate_init(heap, heap.bounds(), true);
 			Debug::Assert(gm != nullptr, "gm should not be null");
+			heapRegions[0] = {gm, 0};
+#ifdef CHERIOT_HEAP_REGIONS
+			size_t region = 1;
+#	define CHERIOT_HEAP_REGION(name, preferredMaxAllocation)                   \
+		heap_region_init(                                                      \
+		  region++,                                                            \
+		  MMIO_CAPABILITY_WITH_PERMISSIONS(void, name, true, true, true, true), \
+		  preferredMaxAllocation);
+			CHERIOT_HEAP_REGIONS
+#	undef CHERIOT_HEAP_REGION
+#endif
+		}
+	}
+
+	/**
+	 * Call `visit` with the memory space of each heap region that is in use.
+	 */
+	template<typename Visitor>
+	__always_inline void heap_regions_each(Visitor &&visit)
+	{
+		for (auto &region : heapRegions)
+		{
+			if (region.state != nullptr)
+			{
+				visit(*region.state);
+			}
+		}
+	}
+
+	/**
+	 * Call `visit` with the memory space of each heap region in the order in
+	 * which an allocation of `bytes` bytes should try them, until it returns
+	 * true.  Regions whose preferred allocation size covers `bytes` come
+	 * first, then the main heap, then the remaining regions.  Returns true if
+	 * `visit` returned true.
+	 */
+	template<typename Visitor>
+	__always_inline bool heap_regions_visit_for_allocation(size_t    bytes,
+	                                                       Visitor &&visit)
+	{
+		auto isPreferred = [&](HeapRegion &region) {
+			return (region.state != gm) &&
+			       (bytes <= region.preferredMaxAllocation);
+		};
+		for (bool preferred : {true, false})
+		{
+			for (auto &region : heapRegions)
+			{
+				if ((region.state != nullptr) &&
+				    (isPreferred(region) == preferred) &&
+				    visit(*region.state))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Returns the memory space of the heap region that contains `address`.
+	 * Returns the main heap if no region contains it, so the result can
+	 * always be used to look up (and fail to find) an allocation.
+	 */
+	MState *heap_region_for(ptraddr_t address)
+	{
+		if constexpr (HeapRegionCount > 1)
+		{
+			for (auto &region : heapRegions)
+			{
+				if ((region.state != nullptr) &&
+				    (address >= region.state->heapStart.address()) &&
+				    (address < region.state->heapStart.top()))
+				{
+					return region.state;
+				}
+			}
+		}
+		return gm;
+	}
+
+	/**
+	 * Returns the total number of free bytes in all heap regions.
+	 */
+	size_t heap_free_size()
+	{
+		size_t size = 0;
+		heap_regions_each([&](MState &state) { size += state.heapFreeSize; });
+		return size;
+	}
+
+	/**
+	 * Returns the total number of quarantined bytes in all heap regions.
+	 */
+	size_t heap_quarantine_size()
+	{
+		size_t size = 0;
+		heap_regions_each(
+		  [&](MState &state) { size += state.heapQuarantineSize; });
+		return size;
+	}
+
+	/**
+	 * Move chunks out of quarantine in each heap region.  Returns true if any
+	 * chunks were moved.
+	 */
+	bool heap_quarantine_dequeue()
+	{
+		bool dequeued = false;
+		heap_regions_each(
+		  [&](MState &state) { dequeued |= state.quarantine_dequeue(); });
+		return dequeued;
+	}
+
+	/**
+	 * The owned-chunk index is an open-addressed hash set, stored in each
+	 * allocator capability, of the chunks that the capability owns or holds a
+	 * claim on.  It allows `heap_free_all` to visit only those chunks, rather
+	 * than walking the entire heap with the lock held.
+	 *
+	 * Chunks are recorded as 16-bit shifted offsets of their bodies from the
+	 * start of the main heap, the same encoding that claims use.  Any
+	 * additional heap regions are above the main heap and within the range
+	 * of this encoding.  The encoding of
+	 * a body is never zero (the first chunk header is at the start of the
+	 * heap), so zero marks an empty slot.  Removed entries are replaced with
+	 * a tombstone so that entries never move while `heap_free_all` iterates
+	 * over the table.
+	 */
+	static constexpr uint16_t OwnedChunkEmpty     = 0;
+	static constexpr uint16_t OwnedChunkTombstone = UINT16_MAX;
+
+	/**
+	 * The number of slots in a newly created owned-chunk index.
+	 */
+	static constexpr uint16_t OwnedChunkMinimumCapacity = 8;
+
+	/**
+	 * The owned-chunk indexes of all allocator capabilities together may use
+	 * at most this fraction of the main heap.  They are allocator metadata
+	 * and are not charged to any quota, so this bounds how much memory
+	 * compartments can make the allocator use on their behalf.
+	 */
+	static constexpr size_t OwnedChunkTablesHeapShare = 32;
+
+	/**
+	 * The number of bytes currently used by owned-chunk indexes.
+	 */
+	size_t ownedChunkTablesSize;
+
+	/**
+	 * Returns the number of slots in the owned-chunk index for `owner`.
+	 */
+	size_t owned_chunk_capacity(PrivateAllocatorCapabilityState &owner)
+	{
+		return (owner.ownedChunkCapacityLog2 == 0)
+		         ? 0
+		         : size_t(1) << owner.ownedChunkCapacityLog2;
+	}
+
+	/**
+	 * Encode a chunk for the owned-chunk index.
+	 */
+	uint16_t owned_chunk_encode(MChunkHeader &chunk)
+	{
+		ptraddr_t offset =
+		  chunk.body().address() - gm->heapStart.address();
+		offset >>= MallocAlignShift;
+		Debug::Assert((offset != OwnedChunkEmpty) &&
+		                (offset < OwnedChunkTombstone),
+		              "Chunk offset {} cannot be encoded",
+		              offset);
+		return offset;
+	}
+
+	/**
+	 * Decode an entry in the owned-chunk index and return the chunk header.
+	 */
+	MChunkHeader *owned_chunk_decode(uint16_t encoded)
+	{
+		ptraddr_t address =
+		  gm->heapStart.address() + (encoded << MallocAlignShift);
+		Capability<void> body{heap_region_for(address)->heapStart};
+		body.address() = address;
+		return MChunkHeader::from_body(body);
+	}
+
+	/**
+	 * Returns the home slot for `encoded` in an index of `capacity` slots.
+	 */
+	size_t owned_chunk_slot(uint16_t encoded, size_t capacity)
+	{
+		// Fibonacci hashing: take the top bits of the product.
+		uint32_t hash = encoded * 2654435769U;
+		return hash >> (32 - __builtin_ctz(capacity));
+	}
+
+	/**
+	 * Insert `encoded` into an index of `capacity` slots, which must have at
+	 * least one empty slot.  Returns true if this used a previously empty
+	 * slot, false if it reused a tombstone.
+	 */
+	bool owned_chunk_insert(uint16_t *table, size_t capacity, uint16_t encoded)
+	{
+		size_t mask      = capacity - 1;
+		size_t tombstone = capacity;
+		for (size_t i = owned_chunk_slot(encoded, capacity);; i = (i + 1) & mask)
+		{
+			if ((table[i] == OwnedChunkTombstone) && (tombstone == capacity))
+			{
+				tombstone = i;
+			}
+			else if (table[i] == OwnedChunkEmpty)
+			{
+				if (tombstone != capacity)
+				{
+					table[tombstone] = encoded;
+					return false;
+				}
+				table[i] = encoded;
+				return true;
+			}
+		}
+	}
+
+	/**
+	 * Returns the chunk that holds an owned-chunk index table.
+	 */
+	MChunkHeader *owned_chunks_table_chunk(uint16_t *table)
+	{
+		Capability heap{gm->heapStart};
+		heap.address() = Capability{table}.address();
+		return MChunkHeader::from_body(heap);
+	}
+
+	/**
+	 * Free an owned-chunk index table of `capacity` slots.
+	 */
+	void owned_chunks_table_free(uint16_t *table, size_t capacity)
+	{
+		auto chunk = owned_chunks_table_chunk(table);
+		ownedChunkTablesSize -= chunk->size_get();
+		// Nothing outside the allocator ever sees this table, so it can't be
+		// on a hazard list.
+		gm->mspace_free(
+		  *chunk, capacity * sizeof(uint16_t), MState::HazardCheck::Skip);
+	}
+
+	/**
+	 * Free the owned-chunk index for `owner`, which must be empty.
+	 */
+	void owned_chunks_release(PrivateAllocatorCapabilityState &owner)
+	{
+		if (owner.ownedChunks != nullptr)
+		{
+			owned_chunks_table_free(owner.ownedChunks,
+			                        owned_chunk_capacity(owner));
+		}
+		owner.ownedChunks            = nullptr;
+		owner.ownedChunkCapacityLog2 = 0;
+		owner.ownedChunkSlotsUsed    = 0;
+		owner.ownedChunkCount        = 0;
+	}
+
+	/**
+	 * Replace the owned-chunk index for `owner` with an empty one that has
+	 * space for at least `count` live entries and then reinsert all of the
+	 * live entries from the old table.  The tables are allocated from the
+	 * heap but are allocator metadata and so are not charged to the owner's
+	 * quota.  Instead, all tables together are limited to a fixed share of
+	 * the heap (see `OwnedChunkTablesHeapShare`).
+	 *
+	 * Returns false if the new table cannot be allocated.
+	 */
+	bool owned_chunks_rebuild(PrivateAllocatorCapabilityState &owner,
+	                          size_t                           count)
+	{
+		// Keep the load factor at or below one half after rebuilding.
+		size_t capacity = OwnedChunkMinimumCapacity;
+		while (capacity < count * 2)
+		{
+			capacity <<= 1;
+		}
+		if (capacity > UINT16_MAX)
+		{
+			return false;
+		}
+		// The old table is freed once its entries have been copied, so it
+		// does not count against the limit for the new one.
+		size_t    tableSize   = capacity * sizeof(uint16_t);
+		uint16_t *oldTable    = owner.ownedChunks;
+		size_t    oldCapacity = owned_chunk_capacity(owner);
+		size_t    oldSize     = 0;
+		if (oldTable != nullptr)
+		{
+			oldSize = owned_chunks_table_chunk(oldTable)->size_get();
+		}
+		if (ownedChunkTablesSize - oldSize + tableSize >
+		    gm->heapTotalSize / OwnedChunkTablesHeapShare)
+		{
+			return false;
+		}
+		size_t unlimitedQuota = SIZE_MAX;
+		auto   space = gm->mspace_dispatch(tableSize, unlimitedQuota, 0);
+		if (!std::holds_alternative<Capability<void>>(space))
+		{
+			return false;
+		}
+		Capability<uint16_t> table =
+		  std::get<Capability<void>>(space).cast<uint16_t>();
+		ownedChunkTablesSize += owned_chunks_table_chunk(table)->size_get();
+		for (size_t i = 0; i < oldCapacity; i++)
+		{
+			uint16_t encoded = oldTable[i];
+			if ((encoded != OwnedChunkEmpty) &&
+			    (encoded != OwnedChunkTombstone))
+			{
+				owned_chunk_insert(table, capacity, encoded);
+			}
+		}
+		owner.ownedChunks            = table;
+		owner.ownedChunkCapacityLog2 = __builtin_ctz(capacity);
+		owner.ownedChunkSlotsUsed    = owner.ownedChunkCount;
+		if (oldTable != nullptr)
+		{
+			owned_chunks_table_free(oldTable, oldCapacity);
+		}
+		return true;
+	}
+
+	/**
+	 * Record that `owner` now owns or holds a claim on `chunk`.  If the index
+	 * cannot be grown, the owner is marked as having an incomplete index and
+	 * `heap_free_all` will fall back to walking the whole heap.
+	 */
+	void owned_chunk_add(PrivateAllocatorCapabilityState &owner,
+	                     MChunkHeader                    &chunk)
+	{
+		if (owner.ownedChunksIncomplete)
+		{
+			return;
+		}
+		// Rebuild when three quarters of the slots are live or tombstones.
+		if ((owner.ownedChunkSlotsUsed + 1) * 4 >
+		    owned_chunk_capacity(owner) * 3)
+		{
+			if (!owned_chunks_rebuild(owner, owner.ownedChunkCount + 1))
+			{
+				Debug::log<DebugLevel::Warning>(
+				  "Unable to grow owned-chunk index for {}",
+				  owner.identifier);
+				owner.ownedChunksIncomplete = true;
+				return;
+			}
+		}
+		if (owned_chunk_insert(owner.ownedChunks,
+		                       owned_chunk_capacity(owner),
+		                       owned_chunk_encode(chunk)))
+		{
+			owner.ownedChunkSlotsUsed++;
+		}
+		owner.ownedChunkCount++;
+	}
+
+	/**
+	 * Give back memory from the owned-chunk index for `owner` if it has
+	 * become mostly empty.  An empty index is freed.  A complete index that
+	 * is less than one eighth full is rebuilt with a load factor of at most
+	 * one half.  Rebuilding allocates, so this must not be called while the
+	 * hazard list is held or in the middle of freeing a chunk.
+	 */
+	void owned_chunks_shrink(PrivateAllocatorCapabilityState &owner)
+	{
+		if (owner.ownedChunksPinned)
+		{
+			return;
+		}
+		if (owner.ownedChunkCount == 0)
+		{
+			owned_chunks_release(owner);
+			return;
+		}
+		size_t capacity = owned_chunk_capacity(owner);
+		if (!owner.ownedChunksIncomplete &&
+		    (capacity > OwnedChunkMinimumCapacity) &&
+		    (owner.ownedChunkCount * 8 < capacity))
+		{
+			// If this fails, keep using the larger table.
+			(void)owned_chunks_rebuild(owner, owner.ownedChunkCount);
 		}
 	}
 
 	/**
-	 * Futex value to allow a thread to wait for another thread to free an
-	 * object.
+	 * Record that `owner` no longer owns or holds a claim on `chunk`.
 	 */
-	cheriot::atomic<int32_t> freeFutex = -1;
+	void owned_chunk_remove(PrivateAllocatorCapabilityState &owner,
+	                        MChunkHeader                    &chunk)
+	{
+		size_t capacity = owned_chunk_capacity(owner);
+		if (capacity == 0)
+		{
+			return;
+		}
+		uint16_t  encoded = owned_chunk_encode(chunk);
+		uint16_t *table   = owner.ownedChunks;
+		size_t    mask    = capacity - 1;
+		for (size_t i = owned_chunk_slot(encoded, capacity), probes = 0;
+		     (table[i] != OwnedChunkEmpty) && (probes < capacity);
+		     i = (i + 1) & mask, probes++)
+		{
+			if (table[i] == encoded)
+			{
+				table[i] = OwnedChunkTombstone;
+				owner.ownedChunkCount--;
+				// Freeing an empty index does not allocate, so it is safe
+				// here even if the caller holds the hazard list.
+				if ((owner.ownedChunkCount == 0) && !owner.ownedChunksPinned)
+				{
+					owned_chunks_release(owner);
+				}
+				return;
+			}
+		}
+		// Entries may be missing only if the index is incomplete.
+		Debug::Assert(owner.ownedChunksIncomplete,
+		              "Chunk {} is missing from the owned-chunk index for {}",
+		              chunk.body(),
+		              owner.identifier);
+	}
+
+	/**
+	 * Operations recorded in the allocation trace.  These values are part of
+	 * the trace format that `scripts/allocator_trace.py` reads.
+	 */
+	enum class TraceOperation : uint8_t
+	{
+		Allocate = 1,
+		Free     = 2,
+		Claim    = 3,
+		FreeAll  = 4,
+	};
+
+#if ALLOCATOR_TRACE
+	/**
+	 * A record in the allocation trace.
+	 */
+	struct TraceRecord
+	{
+		/// The low 32 bits of the cycle counter when the record was written.
+		uint32_t timestamp;
+		/// The address of the object, or zero if there isn't one.
+		ptraddr_t address;
+		/**
+		 * The requested size for allocations, the object size for claims, and
+		 * the number of bytes freed for `heap_free_all`.
+		 */
+		uint32_t size;
+		/// The identifier of the allocator capability used.
+		uint16_t owner;
+		/// The operation.
+		TraceOperation operation;
+		/// Zero on success, or a negative errno value.
+		int8_t result;
+	};
+	static_assert(sizeof(TraceRecord) == 16);
+
+	/**
+	 * The number of records in the trace ring.  When the ring is full, the
+	 * oldest records are overwritten.
+	 */
+	constexpr size_t TraceRecords = 256;
+
+	/// The trace ring.
+	TraceRecord traceRing[TraceRecords];
+
+	/**
+	 * The total number of records written.  The next record is written at
+	 * `traceWritten % TraceRecords`.  Some failed allocations are recorded
+	 * without the lock held, so this is atomic.
+	 */
+	cheriot::atomic<uint32_t> traceWritten;
+
+	/// The value of `traceWritten` when the trace was last dumped.
+	uint32_t traceDumped;
+
+	using TraceDebug = ConditionalDebug<true, "Allocator trace">;
+#endif
+
+	/**
+	 * Record an operation in the allocation trace, if the allocator is built
+	 * with tracing.
+	 */
+	__always_inline void trace_record(TraceOperation operation,
+	                                  uint16_t       owner,
+	                                  size_t         size,
+	                                  ptraddr_t      address,
+	                                  int            result)
+	{
+#if ALLOCATOR_TRACE
+		TraceRecord &record =
+		  traceRing[traceWritten.fetch_add(1) % TraceRecords];
+		record.timestamp = rdcycle64();
+		record.address   = address;
+		record.size      = size;
+		record.owner     = owner;
+		record.operation = operation;
+		record.result    = result;
+#endif
+	}
+
+	/**
+	 * The number of kinds of allocation failure.  Successful allocations are
+	 * the last alternative in `MState::AllocationResult`.
+	 */
+	constexpr size_t AllocationFailureKinds =
+	  std::variant_size_v<MState::AllocationResult> - 1;
+	static_assert(std::is_same_v<
+	              std::variant_alternative_t<AllocationFailureKinds,
+	                                         MState::AllocationResult>,
+	              Capability<void>>);
+
+	/**
+	 * The number of times that `malloc_internal` has seen each kind of
+	 * allocation failure, indexed by the failure's index in
+	 * `MState::AllocationResult`.  Reported by `heap_stats`.
+	 */
+	uint32_t allocationFailureCounts[AllocationFailureKinds];
+
+	/**
+	 * Update the quota low-water mark for `capability` after charging
+	 * something to its quota.
+	 */
+	void quota_low_water_update(PrivateAllocatorCapabilityState &capability)
+	{
+		capability.quotaLowWater =
+		  std::min(capability.quotaLowWater, capability.quota);
+	}
+
+	/**
+	 * Futex that `heap_housekeeping` sleeps on while the quarantine is empty.
+	 * This is non-zero while a thread is waiting on it.
+	 */
+	cheriot::atomic<uint32_t> housekeepingFutex;
+
+	/**
+	 * Wake any thread sleeping in `heap_housekeeping`.  Must be called with
+	 * the lock held, after objects are freed into quarantine.
+	 */
+	void housekeeping_wake()
+	{
+		if (housekeepingFutex != 0)
+		{
+			housekeepingFutex = 0;
+			housekeepingFutex.notify_all();
+		}
+	}
+
+	/**
+	 * Wake the threads blocked in `malloc_internal` whose allocations may now
+	 * succeed.  Threads waiting for heap space are woken if the free and
+	 * quarantined memory together could satisfy their request.  Threads
+	 * waiting for quota are woken if their allocator capability now has
+	 * enough.  Other waiters are left asleep, rather than all retaking the
+	 * lock only to fail again.
+	 *
+	 * Woken threads are made runnable together and contend for the
+	 * priority-inheriting allocator lock, so the scheduler runs the
+	 * highest-priority waiter first.
+	 *
+	 * Must be called with the lock held, after memory or quota is returned.
+	 */
+	void allocation_waiters_wake()
+	{
+		if (allocationWaitersBlocked == 0)
+		{
+			return;
+		}
+		size_t available = heap_free_size() + heap_quarantine_size();
+		for (size_t i = 0; i < allocationWaiterCount; i++)
+		{
+			AllocationWaiter &waiter = allocationWaiters[i];
+			if (waiter.futex == 0)
+			{
+				continue;
+			}
+			size_t have = (waiter.capability == nullptr)
+			                ? available
+			                : waiter.capability->quota;
+			if ((have >= waiter.neededSize) && (waiter.futex.exchange(0) != 0))
+			{
+				Debug::log("Waking thread {} waiting for {} bytes",
+				           i + 1,
+				           waiter.neededSize);
+				allocationWaitersBlocked--;
+				waiter.futex.notify_one();
+			}
+		}
+	}
 
 	/**
 	 * Helper that returns true if the timeout value permits sleeping.
@@ -247,7 +1001,314 @@ namespace
 				return false;
 			}
 		}
-		return true;
+		return true;
+	}
+
+	/**
+	 * Returns how useful an allocation result is when choosing between the
+	 * results from several heap regions.  Success is most useful, followed by
+	 * a failure that waiting for revocation will fix and then a failure that
+	 * waiting for a free may fix.
+	 */
+	int allocation_result_rank(const MState::AllocationResult &result)
+	{
+		if (std::holds_alternative<Capability<void>>(result))
+		{
+			return 4;
+		}
+		if (std::holds_alternative<MState::AllocationFailureRevocationNeeded>(
+		      result))
+		{
+			return 3;
+		}
+		if (std::holds_alternative<MState::AllocationFailureHeapFull>(result))
+		{
+			return 2;
+		}
+		if (std::holds_alternative<MState::AllocationFailureQuotaExceeded>(
+		      result))
+		{
+			return 1;
+		}
+		return 0;
+	}
+
+	/**
+	 * Try to allocate `bytes` bytes, aligned to `alignment`, from each heap
+	 * region in order of preference.  Returns the first success or, if every
+	 * region fails, the most useful failure.  `region` is set to the region
+	 * that returned the result.  The allocation is charged to `quota` and
+	 * owned by `identifier`.
+	 */
+	MState::AllocationResult
+	heap_regions_dispatch(size_t   bytes,
+	                      size_t  &quota,
+	                      uint16_t identifier,
+	                      bool     isSealedAllocation,
+	                      size_t   alignment,
+	                      MState *&region)
+	{
+		MState::AllocationResult ret = MState::AllocationFailurePermanent{};
+		region                       = gm;
+		heap_regions_visit_for_allocation(bytes, [&](MState &state) {
+			auto result = state.mspace_dispatch(
+			  bytes, quota, identifier, isSealedAllocation, alignment);
+			if (allocation_result_rank(result) > allocation_result_rank(ret))
+			{
+				ret    = result;
+				region = &state;
+			}
+			return std::holds_alternative<Capability<void>>(ret);
+		});
+		return ret;
+	}
+
+#if ALLOCATOR_SEALED_CACHE
+	/**
+	 * A destroyed sealed object that is held, still marked in use, so that it
+	 * can be reused by a later allocation with the same sealing key.
+	 */
+	struct SealedObjectCacheEntry
+	{
+		/// The chunk that holds the object, or null if this entry is unused.
+		MChunkHeader *chunk;
+		/// The sealing type of the key that the object was allocated with.
+		uint32_t sealingType;
+		/// The size of the body of the chunk, from `chunk_body_size`.
+		uint32_t bodySize;
+		/// The revocation epoch that must finish before the chunk is reused.
+		uint32_t epoch;
+	};
+
+	/// The number of destroyed sealed objects that the cache can hold.
+	constexpr size_t SealedObjectCacheSize = 16;
+
+	/**
+	 * The number of cache entries that objects sealed with a single key may
+	 * use, so that one kind of object cannot take over the cache.
+	 */
+	constexpr size_t SealedObjectCachePerKey = 4;
+
+	/**
+	 * The largest object, including its header, that the cache will hold.
+	 * Larger objects are rarely churned and would tie up too much memory.
+	 */
+	constexpr size_t SealedObjectCacheMaxSize = 512;
+
+	/**
+	 * Destroyed sealed objects awaiting reuse.  Their chunks are owned by
+	 * `MChunkHeader::SealedCachedOwnerID` and their bodies are zeroed and
+	 * painted in the revocation bitmap, as if they were in quarantine.
+	 */
+	SealedObjectCacheEntry sealedObjectCache[SealedObjectCacheSize];
+
+	/**
+	 * Try to retire `object`, a sealed object owned by `owner`, into the
+	 * sealed-object cache instead of freeing it.  The object is zeroed and
+	 * all pointers to it are invalidated, exactly as if it had been freed,
+	 * and the quota is refunded.
+	 *
+	 * Returns false, leaving the object untouched, if the object cannot be
+	 * freed by `owner`, is claimed, is on a hazard list, or if the cache has
+	 * no space for it.
+	 */
+	bool sealed_object_cache_retire(PrivateAllocatorCapabilityState &owner,
+	                                SealedAllocation                 object)
+	{
+		Capability<void> mem{object};
+		MState          *region = heap_region_for(mem.address());
+		auto            *chunk  = region->allocation_start(mem.address());
+		if ((chunk == nullptr) || (chunk->owner() != owner.identifier) ||
+		    (chunk->claims != 0) || !chunk->isSealedObject)
+		{
+			return false;
+		}
+		size_t bodySize = region->chunk_body_size(*chunk);
+		if ((chunk->body().address() != mem.base()) ||
+		    (bodySize != mem.length()) ||
+		    (bodySize > SealedObjectCacheMaxSize))
+		{
+			return false;
+		}
+		uint32_t                sealingType = object->type;
+		SealedObjectCacheEntry *unused      = nullptr;
+		size_t                  sameKey     = 0;
+		for (auto &entry : sealedObjectCache)
+		{
+			if (entry.chunk == nullptr)
+			{
+				unused = &entry;
+			}
+			else if (entry.sealingType == sealingType)
+			{
+				sameKey++;
+			}
+		}
+		uint32_t epoch;
+		if ((unused == nullptr) || (sameKey >= SealedObjectCachePerKey) ||
+		    !region->mspace_retire(*chunk, bodySize, epoch))
+		{
+			return false;
+		}
+		owned_chunk_remove(owner, *chunk);
+		owner.quota += chunk->size_get();
+		chunk->set_owner(MChunkHeader::SealedCachedOwnerID);
+		*unused = {chunk, sealingType, uint32_t(bodySize), epoch};
+		trace_record(
+		  TraceOperation::Free, owner.identifier, 0, mem.address(), 0);
+		return true;
+	}
+
+	/**
+	 * Try to allocate `bytes` bytes for a sealed object with the sealing type
+	 * `sealingType` from the sealed-object cache, charging `owner`.  Only an
+	 * object whose chunk is the size that a new allocation would have, and
+	 * whose revocation has finished, is reused.
+	 *
+	 * Returns null if there is no such object or if `owner` does not have
+	 * enough quota, in which case the caller should use the general
+	 * allocator.
+	 */
+	void *sealed_object_cache_reuse(PrivateAllocatorCapabilityState &owner,
+	                                uint32_t sealingType,
+	                                size_t   bytes)
+	{
+		size_t alignSize =
+		  (CHERI::representable_length(bytes) + MallocAlignMask) &
+		  ~MallocAlignMask;
+		bool waiting = false;
+		for (auto &entry : sealedObjectCache)
+		{
+			if ((entry.chunk == nullptr) ||
+			    (entry.sealingType != sealingType) ||
+			    (entry.bodySize < alignSize) ||
+			    (entry.bodySize > alignSize + MallocAlignment))
+			{
+				continue;
+			}
+			if (!revoker.has_revocation_finished_for_epoch(entry.epoch))
+			{
+				waiting = true;
+				continue;
+			}
+			MChunkHeader *chunk     = entry.chunk;
+			size_t        chunkSize = chunk->size_get();
+			if (chunkSize > owner.quota)
+			{
+				return nullptr;
+			}
+			revoker.shadow_paint_range<false>(chunk->body().address(),
+			                                  chunk->cell_next());
+			chunk->set_owner(owner.identifier);
+			owner.quota -= chunkSize;
+			owned_chunk_add(owner, *chunk);
+			quota_low_water_update(owner);
+			Capability<void> body{
+			  heap_region_for(chunk->body().address())->heapStart};
+			body.address() = chunk->body().address();
+			body.bounds()  = entry.bodySize;
+			entry          = {};
+			trace_record(TraceOperation::Allocate,
+			             owner.identifier,
+			             bytes,
+			             body.address(),
+			             0);
+			return body;
+		}
+		// Make progress towards reusing the objects that are waiting.
+		if constexpr (Revocation::Revoker::IsAsynchronous)
+		{
+			if (waiting)
+			{
+				revoker.system_bg_revoker_kick();
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 * Free every object in the sealed-object cache.  Objects whose revocation
+	 * has finished return to the free lists, the rest go into quarantine.
+	 * Returns true if the cache held any objects.
+	 */
+	bool sealed_object_cache_flush()
+	{
+		bool flushed = false;
+		for (auto &entry : sealedObjectCache)
+		{
+			if (entry.chunk != nullptr)
+			{
+				heap_region_for(entry.chunk->body().address())
+				  ->mspace_retired_free(*entry.chunk, entry.epoch);
+				entry   = {};
+				flushed = true;
+			}
+		}
+		return flushed;
+	}
+#else
+	bool sealed_object_cache_retire(PrivateAllocatorCapabilityState &,
+	                                SealedAllocation)
+	{
+		return false;
+	}
+
+	void *sealed_object_cache_reuse(PrivateAllocatorCapabilityState &,
+	                                uint32_t,
+	                                size_t)
+	{
+		return nullptr;
+	}
+
+	bool sealed_object_cache_flush()
+	{
+		return false;
+	}
+#endif
+
+	/**
+	 * Wait until a free may have made `neededSize` bytes available, either in
+	 * the quota of `capability` or, if `capability` is null, in the heap, or
+	 * until `timeout` expires.  The lock is dropped while waiting.
+	 *
+	 * Returns false if the lock could not be reacquired.
+	 */
+	bool allocation_wait(PrivateAllocatorCapabilityState *capability,
+	                     size_t                           neededSize,
+	                     Timeout                         *timeout,
+	                     LockGuard<decltype(lock)>       &g)
+	{
+		// Record what we are waiting for, so that frees wake us only once
+		// this allocation may be able to succeed.  Frees happen with the lock
+		// held, so none can be missed between here and the wait.
+		uint16_t threadID = thread_id_get();
+		Debug::Assert((threadID > 0) && (threadID <= allocationWaiterCount),
+		              "Thread ID {} has no allocation waiter record",
+		              threadID);
+		AllocationWaiter &waiter = allocationWaiters[threadID - 1];
+		waiter.capability        = capability;
+		waiter.neededSize        = neededSize;
+		waiter.futex             = 1;
+		allocationWaitersBlocked++;
+		// If there are things on the hazard list, wake after one tick and see
+		// if they have gone away.  Otherwise, wait until we have some newly
+		// freed objects.
+		bool hazardQuarantinesEmpty = true;
+		heap_regions_each([&](MState &state) {
+			hazardQuarantinesEmpty &= state.hazard_quarantine_is_empty();
+		});
+		Timeout t{hazardQuarantinesEmpty ? timeout->remaining : 1};
+		// Drop the lock while yielding
+		g.unlock();
+		waiter.futex.wait(&t, 1);
+		timeout->elapse(t.elapsed);
+		// If we timed out, no waker removed us from the count.
+		if (waiter.futex.exchange(0) != 0)
+		{
+			allocationWaitersBlocked--;
+		}
+		Debug::log("Woke from futex wake");
+		return reacquire_lock(timeout, g);
 	}
 
 	/**
@@ -264,26 +1325,84 @@ namespace
 	 *
 	 * If `isSealedAllocation` is true, then the allocation is marked as sealed
 	 * and excluded during `heap_free_all`.
+	 *
+	 * The allocation is aligned to at least `alignment`, which must be a power
+	 * of two.
+	 *
+	 * If `reservation` is not null, the allocation is part of a batch.  It is
+	 * charged to the quota that the batch has reserved, and then to any
+	 * remaining quota in `capability`.  The chunk is owned by
+	 * `MChunkHeader::BatchPendingOwnerID`, rather than by `capability`, until
+	 * the caller publishes it.
 	 */
 	void *malloc_internal(size_t                           bytes,
 	                      LockGuard<decltype(lock)>      &&g,
 	                      PrivateAllocatorCapabilityState *capability,
 	                      Timeout                         *timeout,
 	                      bool     isSealedAllocation = false,
-	                      uint32_t flags              = AllocateWaitAny)
+	                      uint32_t flags              = AllocateWaitAny,
+	                      size_t   alignment          = MallocAlignment,
+	                      size_t  *reservation        = nullptr)
 	{
 		check_gm();
 
+		auto dispatch = [&](MState *&region) {
+			if (reservation == nullptr)
+			{
+				return heap_regions_dispatch(bytes,
+				                             capability->quota,
+				                             capability->identifier,
+				                             isSealedAllocation,
+				                             alignment,
+				                             region);
+			}
+			size_t available = *reservation + capability->quota;
+			auto   ret =
+			  heap_regions_dispatch(bytes,
+			                        available,
+			                        MChunkHeader::BatchPendingOwnerID,
+			                        isSealedAllocation,
+			                        alignment,
+			                        region);
+			// Take the charge from the reservation first.
+			size_t charged  = *reservation + capability->quota - available;
+			size_t reserved = std::min(charged, *reservation);
+			*reservation -= reserved;
+			capability->quota -= charged - reserved;
+			return ret;
+		};
+
 		do
 		{
-			auto ret = gm->mspace_dispatch(bytes,
-			                               capability->quota,
-			                               capability->identifier,
-			                               isSealedAllocation);
+			MState *region;
+			auto    ret = dispatch(region);
+			// Destroyed sealed objects that are waiting for reuse may be
+			// holding the memory that this needs.
+			bool isHeapFull =
+			  std::holds_alternative<MState::AllocationFailureHeapFull>(ret);
+			if (isHeapFull && sealed_object_cache_flush())
+			{
+				ret = dispatch(region);
+			}
 			if (std::holds_alternative<Capability<void>>(ret))
 			{
-				return std::get<Capability<void>>(ret);
+				Capability<void> allocation = std::get<Capability<void>>(ret);
+				if (reservation == nullptr)
+				{
+					Capability<void> body{region->heapStart};
+					body.address() = allocation.address();
+					owned_chunk_add(*capability,
+					                *MChunkHeader::from_body(body));
+					quota_low_water_update(*capability);
+					trace_record(TraceOperation::Allocate,
+					             capability->identifier,
+					             bytes,
+					             allocation.address(),
+					             0);
+				}
+				return allocation;
 			}
+			allocationFailureCounts[ret.index()]++;
 			// If the call is non-blocking (`flags` is
 			// `AllocateWaitNone`, or `timeout` is 0), fail now.
 			if (flags == AllocateWaitNone || !may_block(timeout))
@@ -312,7 +1431,7 @@ namespace
 				// requires individual attention to merge back into the free
 				// pool (and consolidate with neighbors), and each round here
 				// moves at most O(1) chunks out of quarantine.
-				if (!gm->quarantine_dequeue())
+				if (!region->quarantine_dequeue())
 				{
 					Debug::log("Quarantine has enough memory to satisfy "
 					           "allocation, kicking revoker");
@@ -350,25 +1469,17 @@ namespace
 				Debug::log("Not enough free space to handle {}-byte "
 				           "allocation, sleeping",
 				           bytes);
-				// Use the current free space as the sleep futex value.  This
-				// means that the `wait` call will fail if the amount of free
-				// memory changes between dropping the lock and waiting, unless
-				// a matched number of allocations and frees happen (in which
-				// case, we're happy to sleep because we still can't manage
-				// this allocation).
-				auto expected = gm->heapFreeSize;
-				freeFutex     = expected;
-				// If there are things on the hazard list, wake after one tick
-				// and see if they have gone away.  Otherwise, wait until we
-				// have some newly freed objects.
-				Timeout t{gm->hazard_quarantine_is_empty() ? timeout->remaining
-				                                           : 1};
-				// Drop the lock while yielding
-				g.unlock();
-				freeFutex.wait(&t, expected);
-				timeout->elapse(t.elapsed);
-				Debug::log("Woke from futex wake");
-				if (!reacquire_lock(timeout, g))
+				size_t alignSize =
+				  (CHERI::representable_length(bytes) + MallocAlignMask) &
+				  ~MallocAlignMask;
+				bool reacquired =
+				  isQuotaExceededFailure
+				    ? allocation_wait(capability, alignSize, timeout, g)
+				    : allocation_wait(nullptr,
+				                      alignSize + sizeof(MChunkHeader),
+				                      timeout,
+				                      g);
+				if (!reacquired)
 				{
 					return nullptr;
 				}
@@ -404,11 +1515,12 @@ namespace
 		if (state->identifier == 0)
 		{
 			static uint32_t nextIdentifier = 1;
-			if (nextIdentifier >= (1 << MChunkHeader::OwnerIDWidth))
+			if (nextIdentifier >= MChunkHeader::ClaimOwnerID)
 			{
 				return nullptr;
 			}
-			state->identifier = nextIdentifier++;
+			state->identifier    = nextIdentifier++;
+			state->quotaLowWater = state->quota;
 		}
 		return state;
 	}
@@ -568,7 +1680,7 @@ namespace
 		                     uint16_t                         next)
 		{
 			auto space = gm->mspace_dispatch(
-			  sizeof(Claim), capability.quota, capability.identifier);
+			  sizeof(Claim), capability.quota, MChunkHeader::ClaimOwnerID);
 			if (!std::holds_alternative<Capability<void>>(space))
 			{
 				return nullptr;
@@ -589,8 +1701,11 @@ namespace
 			capability.quota += chunk->size_get();
 			// We could skip quarantine for these objects, since we know that
 			// they haven't escaped, but they're small so it's probably not
-			// worthwhile.
-			gm->mspace_free(*chunk, sizeof(Claim));
+			// worthwhile.  They can't be on a hazard list though, so skip
+			// that check.  This also means that claims can be dropped while
+			// the caller holds the hazard list.
+			gm->mspace_free(
+			  *chunk, sizeof(Claim), MState::HazardCheck::Skip);
 		}
 
 		/**
@@ -704,11 +1819,17 @@ namespace
 			Debug::log("Allocated new claim");
 			// If this is the owner, remove the owner and downgrade our
 			// ownership to a claim.  This simplifies the deallocation path.
+			// The chunk is already in the owner's index.
 			if (isOwner)
 			{
 				chunk.ownerID = 0;
 				claim->reference_add();
 			}
+			else
+			{
+				owned_chunk_add(owner, chunk);
+			}
+			quota_low_water_update(owner);
 			next = claim->encode_address();
 			return true;
 		}
@@ -752,6 +1873,7 @@ namespace
 			size_t size = chunk.size_get();
 			owner.quota += size;
 			Claim::destroy(owner, claim);
+			owned_chunk_remove(owner, chunk);
 			Debug::log("Dropped last claim, refunding {}-byte quota for {}",
 			           size,
 			           chunk.body());
@@ -765,15 +1887,18 @@ namespace
 	 * false then this will drop a claim but will not free the object as the
 	 * owner.  If `reallyFree` is false then this will not actually perform the
 	 * operation it will simply report whether it *would* succeed.
+	 * `hazardCheck` is passed to `mspace_free`.
 	 *
 	 * Returns 0 on success, `-EPERM` if the provided owner cannot free this
 	 * chunk.
 	 */
-	__noinline int heap_free_chunk(PrivateAllocatorCapabilityState &owner,
-	                               MChunkHeader                    &chunk,
-	                               size_t                           bodySize,
-	                               bool isPrecise  = true,
-	                               bool reallyFree = true)
+	__noinline int heap_free_chunk(
+	  PrivateAllocatorCapabilityState &owner,
+	  MChunkHeader                    &chunk,
+	  size_t                           bodySize,
+	  bool                             isPrecise   = true,
+	  bool                             reallyFree  = true,
+	  MState::HazardCheck              hazardCheck = MState::HazardCheck::Full)
 	{
 		// If this is a precise allocation, see if we can free it as the
 		// original owner.  You may drop claims with a capability that is a
@@ -786,9 +1911,12 @@ namespace
 			}
 			size_t chunkSize = chunk.size_get();
 			chunk.ownerID    = 0;
+			owned_chunk_remove(owner, chunk);
 			if (chunk.claims == 0)
 			{
-				int ret = gm->mspace_free(chunk, bodySize);
+				int ret =
+				  heap_region_for(chunk.body().address())
+				    ->mspace_free(chunk, bodySize, hazardCheck);
 				// If free fails, don't manipulate the quota.
 				if (ret == 0)
 				{
@@ -808,13 +1936,55 @@ namespace
 		{
 			if ((chunk.claims == 0) && (chunk.ownerID == 0))
 			{
-				return gm->mspace_free(chunk, bodySize);
+				return heap_region_for(chunk.body().address())
+				  ->mspace_free(chunk, bodySize, hazardCheck);
 			}
 			return 0;
 		}
 		return -EPERM;
 	}
 
+	/**
+	 * Find the chunk that `rawPointer` points into and try to free it (or
+	 * drop a claim on it) with the provided owner.  The `reallyFree` and
+	 * `hazardCheck` parameters are passed to `heap_free_chunk`.
+	 *
+	 * Returns 0 on success, `-EINVAL` if `rawPointer` is not a valid heap
+	 * pointer, or `-EPERM` if the provided owner cannot free it.
+	 */
+	int heap_free_pointer(
+	  PrivateAllocatorCapabilityState &owner,
+	  void                            *rawPointer,
+	  bool                             reallyFree,
+	  MState::HazardCheck              hazardCheck = MState::HazardCheck::Full)
+	{
+		Capability<void> mem{rawPointer};
+		if (!mem.is_valid())
+		{
+			return -EINVAL;
+		}
+		check_gm();
+		// Find the chunk that corresponds to this allocation.
+		MState *region = heap_region_for(mem.address());
+		auto   *chunk  = region->allocation_start(mem.address());
+		if (!chunk)
+		{
+			return -EINVAL;
+		}
+		ptraddr_t start    = chunk->body().address();
+		size_t    bodySize = region->chunk_body_size(*chunk);
+		// Is the pointer that we're freeing a pointer to the entire allocation?
+		bool isPrecise = (start == mem.base()) && (bodySize == mem.length());
+		int  ret       = heap_free_chunk(
+		  owner, *chunk, bodySize, isPrecise, reallyFree, hazardCheck);
+		if (reallyFree)
+		{
+			trace_record(
+			  TraceOperation::Free, owner.identifier, 0, mem.address(), ret);
+		}
+		return ret;
+	}
+
 	__noinline int heap_free_internal(AllocatorCapability heapCapability,
 	                                  void               *rawPointer,
 	                                  bool                reallyFree)
@@ -826,24 +1996,210 @@ namespace
 			                                heapCapability);
 			return -EPERM;
 		}
-		Capability<void> mem{rawPointer};
-		if (!mem.is_valid())
+		int ret = heap_free_pointer(*capability, rawPointer, reallyFree);
+		if (reallyFree)
+		{
+			owned_chunks_shrink(*capability);
+		}
+		return ret;
+	}
+
+	/**
+	 * Shared implementation of `heap_allocate_batch` and
+	 * `heap_allocate_batch_sizes`.  Allocates `count` objects, each of which
+	 * is `size` bytes or, if `sizes` is not null, `sizes[i]` bytes, and
+	 * stores them in `out`.  Either every allocation succeeds or none does.
+	 *
+	 * The quota for the whole batch is reserved once, before anything is
+	 * allocated, and the objects are charged to that reservation.
+	 *
+	 * `malloc_internal` may drop the lock while it waits and the caller may
+	 * free `out` or `sizes` in the meantime.  We therefore do not write to
+	 * `out` until every allocation has succeeded, chaining the new objects
+	 * together through their first word until then.  Until they are
+	 * published, the objects are owned by `MChunkHeader::BatchPendingOwnerID`,
+	 * so that nothing (including `heap_free_all`) can free them while the
+	 * lock is dropped.  Both arrays are reloaded from memory, so that the load
+	 * barrier invalidates them if they have been freed, and rechecked with
+	 * the lock held before each use.
+	 */
+	__noinline int heap_allocate_batch_internal(Timeout            *timeout,
+	                                            AllocatorCapability heapCapability,
+	                                            size_t              size,
+	                                            const size_t       *sizes,
+	                                            size_t              count,
+	                                            void              **out,
+	                                            uint32_t            flags)
+	{
+		if (!check_timeout_pointer(timeout))
 		{
 			return -EINVAL;
 		}
-		check_gm();
-		// Find the chunk that corresponds to this allocation.
-		auto *chunk = gm->allocation_start(mem.address());
-		if (!chunk)
+		size_t outSize;
+		size_t sizesSize;
+		if (__builtin_mul_overflow(count, sizeof(void *), &outSize) ||
+		    __builtin_mul_overflow(count, sizeof(size_t), &sizesSize))
 		{
 			return -EINVAL;
 		}
-		ptraddr_t start    = chunk->body().address();
-		size_t    bodySize = gm->chunk_body_size(*chunk);
-		// Is the pointer that we're freeing a pointer to the entire allocation?
-		bool isPrecise = (start == mem.base()) && (bodySize == mem.length());
-		return heap_free_chunk(
-		  *capability, *chunk, bodySize, isPrecise, reallyFree);
+		void **volatile        outSlot   = out;
+		const size_t *volatile sizesSlot = sizes;
+		auto                   outValid  = [&]() {
+			void **array = outSlot;
+			return check_pointer<PermissionSet{
+			  Permission::Store, Permission::LoadStoreCapability}>(array,
+			                                                       outSize);
+		};
+		auto sizesValid = [&]() {
+			const size_t *array = sizesSlot;
+			return (array == nullptr) || check_pointer(array, sizesSize);
+		};
+		auto sizeAt = [&](size_t i) {
+			const size_t *array = sizesSlot;
+			return (array == nullptr) ? size : array[i];
+		};
+
+		LockGuard g{lock};
+		auto     *capability = malloc_capability_unseal(heapCapability);
+		if (capability == nullptr)
+		{
+			return -EPERM;
+		}
+		if (!outValid() || !sizesValid())
+		{
+			return -EINVAL;
+		}
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		// Compute the quota that the whole batch will consume: each object's
+		// rounded size plus its header.  An object may be charged slightly
+		// more if its chunk could not be split, and that is taken from the
+		// quota that remains after the reservation.
+		size_t reservation = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t bytes     = sizeAt(i);
+			size_t alignSize = (CHERI::representable_length(bytes) +
+			                    MallocAlignMask) &
+			                   ~MallocAlignMask;
+			if ((alignSize == 0) ||
+			    __builtin_add_overflow(
+			      reservation, alignSize + sizeof(MChunkHeader), &reservation))
+			{
+				return -EINVAL;
+			}
+		}
+		while (reservation > capability->quota)
+		{
+			if (!(flags & AllocateWaitQuotaExceeded) || !may_block(timeout) ||
+			    !allocation_wait(capability, reservation, timeout, g))
+			{
+				return -ENOMEM;
+			}
+		}
+		capability->quota -= reservation;
+		quota_low_water_update(*capability);
+
+		// Allocate the objects, linking each one to its predecessor through
+		// its first word.  Every allocation is at least one capability in
+		// size and capability aligned, so this is always in bounds.
+		void  *head      = nullptr;
+		size_t allocated = 0;
+		int    ret       = -ENOMEM;
+		while (allocated < count)
+		{
+			// The lock may have been dropped by the last allocation.
+			if (!sizesValid())
+			{
+				ret = -EINVAL;
+				break;
+			}
+			void *next = malloc_internal(sizeAt(allocated),
+			                             std::move(g),
+			                             capability,
+			                             timeout,
+			                             false,
+			                             flags,
+			                             MallocAlignment,
+			                             &reservation);
+			if (next == nullptr)
+			{
+				break;
+			}
+			*static_cast<void **>(next) = head;
+			head                        = next;
+			allocated++;
+		}
+
+		// A failed allocation may have returned without the lock.  We must
+		// hold it to either publish or roll back the allocations.
+		if (!g)
+		{
+			g.lock();
+		}
+
+		// Return any of the reservation that was not used.
+		capability->quota += reservation;
+
+		auto chunkOf = [](void *object) {
+			ptraddr_t        address = Capability{object}.address();
+			Capability<void> body{heap_region_for(address)->heapStart};
+			body.address() = address;
+			return MChunkHeader::from_body(body);
+		};
+
+		if ((allocated == count) && outValid() && sizesValid())
+		{
+			void **array = outSlot;
+			for (size_t i = count; i > 0; i--)
+			{
+				auto **object = static_cast<void **>(head);
+				head          = *object;
+				*object       = nullptr;
+				array[i - 1]  = object;
+
+				MChunkHeader *chunk = chunkOf(object);
+				chunk->set_owner(capability->identifier);
+				owned_chunk_add(*capability, *chunk);
+				trace_record(TraceOperation::Allocate,
+				             capability->identifier,
+				             sizeAt(i - 1),
+				             Capability{object}.address(),
+				             0);
+			}
+			quota_low_water_update(*capability);
+			return 0;
+		}
+		if (allocated == count)
+		{
+			ret = -EINVAL;
+		}
+
+		// Roll back.  None of these objects has escaped, so free the chunks
+		// directly, without the hazard checks of `heap_free`, but send them
+		// through quarantine anyway, as `Claim::destroy` does.
+		while (head != nullptr)
+		{
+			auto **object = static_cast<void **>(head);
+			head          = *object;
+			*object       = nullptr;
+
+			MChunkHeader *chunk  = chunkOf(object);
+			MState       *region = heap_region_for(chunk->body().address());
+			capability->quota += chunk->size_get();
+			chunk->set_owner(0);
+			region->mspace_free(*chunk,
+			                    region->chunk_body_size(*chunk),
+			                    MState::HazardCheck::Skip);
+		}
+		// We have returned some quota, so wake any threads blocked allocating
+		// memory.
+		allocation_waiters_wake();
+		housekeeping_wake();
+		return ret;
 	}
 
 } // namespace
@@ -872,6 +2228,9 @@ __cheriot_minimum_stack(0xe0) int heap_quarantine_flush(Timeout *timeout)
 
 	if (LockGuard g{lock, timeout})
 	{
+		// Objects in the sealed-object cache are effectively in quarantine,
+		// move them there so that they are included.
+		sealed_object_cache_flush();
 		auto epoch = revoker.system_epoch_get();
 		// Round the epoch up.  Odd epoch numbers indicate in-progress epochs.
 		epoch = (epoch + 1) & ~1U;
@@ -885,9 +2244,9 @@ __cheriot_minimum_stack(0xe0) int heap_quarantine_flush(Timeout *timeout)
 		// Try removing items from quarantine until we've popped all that
 		// we can.  There may still be quarantine things from the previous
 		// epoch.
-		while (gm->quarantine_dequeue()) {}
+		while (heap_quarantine_dequeue()) {}
 		// If we've emptied the quarantine, stop and report success.
-		if (gm->heapQuarantineSize == 0)
+		if (heap_quarantine_size() == 0)
 		{
 			return 0;
 		}
@@ -897,14 +2256,75 @@ __cheriot_minimum_stack(0xe0) int heap_quarantine_flush(Timeout *timeout)
 			return -ETIMEDOUT;
 		}
 		// Remove everything that was freed with the previous revocation.
-		while (gm->quarantine_dequeue()) {}
-		Debug::log("{} bytes left in quarantine", gm->heapQuarantineSize);
+		while (heap_quarantine_dequeue()) {}
+		Debug::log("{} bytes left in quarantine", heap_quarantine_size());
 		return 0;
 	}
 
 	return -ETIMEDOUT;
 }
 
+__cheriot_minimum_stack(0x100) int heap_housekeeping(Timeout *timeout)
+{
+	STACK_CHECK(0x100);
+
+	if (!check_timeout_pointer(timeout))
+	{
+		return -EINVAL;
+	}
+
+	LockGuard g{lock, timeout};
+	if (!g)
+	{
+		return -ETIMEDOUT;
+	}
+	check_gm();
+
+	// Wait for something to be freed.
+	while (heap_quarantine_size() == 0)
+	{
+		if (!may_block(timeout))
+		{
+			return -ETIMEDOUT;
+		}
+		housekeepingFutex = 1;
+		g.unlock();
+		housekeepingFutex.wait(timeout, 1);
+		if (!g.try_lock(timeout))
+		{
+			return -ETIMEDOUT;
+		}
+	}
+
+	// Drain the quarantine in bounded steps.  Dropping the lock between
+	// steps means that a higher-priority thread that wants to allocate or
+	// free waits for at most one step, for which this thread's priority is
+	// boosted by the lock.
+	while (heap_quarantine_size() > 0)
+	{
+		if (!heap_quarantine_dequeue())
+		{
+			// Nothing in quarantine has finished revocation.  Start
+			// revocation, if it isn't running, and wait for it.  With a
+			// synchronous revoker, this does the revocation work here.
+			auto epoch = revoker.system_epoch_get();
+			epoch      = (epoch + 1) & ~1U;
+			revoker.system_bg_revoker_kick();
+			if (!wait_for_background_revoker(timeout, epoch, g))
+			{
+				return -ETIMEDOUT;
+			}
+			continue;
+		}
+		g.unlock();
+		if (!g.try_lock(timeout))
+		{
+			return -ETIMEDOUT;
+		}
+	}
+	return 0;
+}
+
 __cheriot_minimum_stack(0x220) void *heap_allocate(
   Timeout            *timeout,
   AllocatorCapability heapCapability,
@@ -923,7 +2343,51 @@ __cheriot_minimum_stack(0x220) void *heap_allocate(
 		return nullptr;
 	}
 	// Use the default memory space.
-	return malloc_internal(bytes, std::move(g), cap, timeout, false, flags);
+	void *ret =
+	  malloc_internal(bytes, std::move(g), cap, timeout, false, flags);
+	if (ret == nullptr)
+	{
+		trace_record(
+		  TraceOperation::Allocate, cap->identifier, bytes, 0, -ENOMEM);
+	}
+	return ret;
+}
+
+__cheriot_minimum_stack(0x220) void *heap_allocate_aligned(
+  Timeout            *timeout,
+  AllocatorCapability heapCapability,
+  size_t              bytes,
+  size_t              alignment,
+  uint32_t            flags)
+{
+	STACK_CHECK(0x220);
+	if (!check_timeout_pointer(timeout))
+	{
+		return nullptr;
+	}
+	if ((alignment == 0) || ((alignment & (alignment - 1)) != 0))
+	{
+		return nullptr;
+	}
+	LockGuard g{lock};
+	auto     *cap = malloc_capability_unseal(heapCapability);
+	if (cap == nullptr)
+	{
+		return nullptr;
+	}
+	void *ret = malloc_internal(bytes,
+	                            std::move(g),
+	                            cap,
+	                            timeout,
+	                            false,
+	                            flags,
+	                            std::max<size_t>(alignment, MallocAlignment));
+	if (ret == nullptr)
+	{
+		trace_record(
+		  TraceOperation::Allocate, cap->identifier, bytes, 0, -ENOMEM);
+	}
+	return ret;
 }
 
 __cheriot_minimum_stack(0x1c0) ssize_t
@@ -942,17 +2406,22 @@ __cheriot_minimum_stack(0x1c0) ssize_t
 		Debug::log<DebugLevel::Warning>("Invalid claimed cap");
 		return 0;
 	}
-	auto *chunk = gm->allocation_start(Capability{pointer}.address());
+	auto *chunk = heap_region_for(Capability{pointer}.address())
+	                ->allocation_start(Capability{pointer}.address());
 	if (chunk == nullptr)
 	{
 		Debug::log<DebugLevel::Warning>("chunk not found");
 		return 0;
 	}
+	ptraddr_t address = Capability{pointer}.address();
 	if (claim_add(*cap, *chunk))
 	{
-		return gm->chunk_body_size(*chunk);
+		size_t size = gm->chunk_body_size(*chunk);
+		trace_record(TraceOperation::Claim, cap->identifier, size, address, 0);
+		return size;
 	}
 	Debug::log<DebugLevel::Warning>("failed to add claim");
+	trace_record(TraceOperation::Claim, cap->identifier, 0, address, -ENOMEM);
 	return 0;
 }
 
@@ -978,12 +2447,8 @@ int heap_free_nostackcheck(AllocatorCapability heapCapability, void *rawPointer)
 	}
 
 	// If there are any threads blocked allocating memory, wake them up.
-	if (freeFutex != -1)
-	{
-		Debug::log("Some threads are blocking on allocations, waking them");
-		freeFutex = -1;
-		freeFutex.notify_all();
-	}
+	allocation_waiters_wake();
+	housekeeping_wake();
 
 	return 0;
 }
@@ -996,6 +2461,78 @@ __cheriot_minimum_stack(0x260) int heap_free(AllocatorCapability heapCapability,
 	return heap_free_nostackcheck(heapCapability, rawPointer);
 }
 
+__cheriot_minimum_stack(0x280) ssize_t
+  heap_free_batch(AllocatorCapability heapCapability,
+                  void              **pointers,
+                  size_t              count)
+{
+	STACK_CHECK(0x280);
+	if (count > HeapFreeBatchMax)
+	{
+		return -EINVAL;
+	}
+	LockGuard g{lock};
+	auto     *capability = malloc_capability_unseal(heapCapability);
+	if (capability == nullptr)
+	{
+		Debug::log<DebugLevel::Warning>("Invalid heap capability {}",
+		                                heapCapability);
+		return -EPERM;
+	}
+	if (count == 0)
+	{
+		return 0;
+	}
+	// We hold the lock for the whole call, so the array cannot be freed
+	// while we are reading it.
+	if (!check_pointer(pointers, count * sizeof(void *)))
+	{
+		return -EINVAL;
+	}
+	check_gm();
+
+	ssize_t failures = 0;
+	bool    freedAny = false;
+	{
+		// Acquire the hazard list and recheck the hazard quarantine once for
+		// the whole batch, rather than once per object.
+		auto guard = gm->hazard_list_begin();
+		heap_regions_each(
+		  [](MState &state) { state.hazard_pointers_recheck(); });
+		for (size_t i = 0; i < count; i++)
+		{
+			void *pointer = pointers[i];
+			if (pointer == nullptr)
+			{
+				continue;
+			}
+			if (heap_free_pointer(*capability,
+			                      pointer,
+			                      true,
+			                      MState::HazardCheck::ListHeld) == 0)
+			{
+				freedAny = true;
+			}
+			else
+			{
+				failures |= ssize_t(1) << i;
+			}
+		}
+	}
+	// Shrinking may allocate a new table, so it must wait until we have
+	// released the hazard list.
+	owned_chunks_shrink(*capability);
+
+	// If there are any threads blocked allocating memory, wake them up.
+	if (freedAny)
+	{
+		allocation_waiters_wake();
+		housekeeping_wake();
+	}
+
+	return failures;
+}
+
 __cheriot_minimum_stack(0x1a0) ssize_t
   heap_free_all(AllocatorCapability heapCapability)
 {
@@ -1009,42 +2546,147 @@ __cheriot_minimum_stack(0x1a0) ssize_t
 		return -EPERM;
 	}
 
-	auto      chunk   = gm->heapStart.cast<MChunkHeader>();
-	ptraddr_t heapEnd = chunk.top();
-	ssize_t   freed   = 0;
-	do
+	ssize_t freed     = 0;
+	auto    freeChunk = [&](MChunkHeader &chunk) {
+        if (chunk.is_in_use() && !chunk.isSealedObject)
+        {
+            auto size = chunk.size_get();
+            if (heap_free_chunk(
+                  *capability, chunk, gm->chunk_body_size(chunk)) == 0)
+            {
+                freed += size;
+            }
+        }
+	};
+
+	auto eachChunk = [](auto &&visit) {
+		heap_regions_each([&](MState &state) {
+			auto      chunk   = state.heapStart.cast<MChunkHeader>();
+			ptraddr_t heapEnd = chunk.top();
+			do
+			{
+				visit(*chunk);
+				chunk = static_cast<MChunkHeader *>(chunk->cell_next());
+			} while (chunk.address() < heapEnd);
+		});
+	};
+
+	if (__predict_false(capability->ownedChunksIncomplete))
+	{
+		// We don't know every chunk that this capability owns, so fall back
+		// to walking every heap region.
+		eachChunk(freeChunk);
+		// Claim records are owned by `MChunkHeader::ClaimOwnerID`, so the
+		// walk dropped claims through the chunks that they claim rather than
+		// freeing the records directly.  The chunks that this capability
+		// still owns or claims are now its sealed objects and anything on
+		// which it held more than one claim.  Try to rebuild a complete index
+		// of them, sized before walking the heap again so that the heap does
+		// not change while we walk it.  If this fails, we walk the whole heap
+		// again next time.
+		auto isOwned = [&](MChunkHeader &chunk) {
+			return chunk.is_in_use() &&
+			       ((chunk.owner() == capability->identifier) ||
+			        (claim_find(capability->identifier, chunk).second !=
+			         nullptr));
+		};
+		size_t owned = 0;
+		eachChunk([&](MChunkHeader &chunk) { owned += isOwned(chunk); });
+		owned_chunks_release(*capability);
+		if ((owned == 0) || owned_chunks_rebuild(*capability, owned))
+		{
+			eachChunk([&](MChunkHeader &chunk) {
+				if (isOwned(chunk))
+				{
+					owned_chunk_insert(capability->ownedChunks,
+					                   owned_chunk_capacity(*capability),
+					                   owned_chunk_encode(chunk));
+				}
+			});
+			capability->ownedChunkCount       = owned;
+			capability->ownedChunkSlotsUsed   = owned;
+			capability->ownedChunksIncomplete = false;
+		}
+	}
+	else
+	{
+		// Visit only the chunks in this capability's index.  Freeing replaces
+		// entries with tombstones and never moves or adds entries, and the
+		// table is pinned so that it is not shrunk, so it is stable while we
+		// iterate over it.
+		uint16_t *table    = capability->ownedChunks;
+		size_t    capacity = owned_chunk_capacity(*capability);
+
+		capability->ownedChunksPinned = true;
+		for (size_t i = 0; i < capacity; i++)
+		{
+			uint16_t encoded = table[i];
+			if ((encoded != OwnedChunkEmpty) &&
+			    (encoded != OwnedChunkTombstone))
+			{
+				freeChunk(*owned_chunk_decode(encoded));
+			}
+		}
+		capability->ownedChunksPinned = false;
+	}
+	owned_chunks_shrink(*capability);
+
+	// If there are any threads blocked allocating memory, wake them up.
+	if (freed > 0)
+	{
+		allocation_waiters_wake();
+		housekeeping_wake();
+	}
+
+	trace_record(TraceOperation::FreeAll, capability->identifier, freed, 0, 0);
+
+	return freed;
+}
+
+__cheriot_minimum_stack(0x220) void *heap_allocate_array(
+  Timeout            *timeout,
+  AllocatorCapability heapCapability,
+  size_t              nElements,
+  size_t              elemSize,
+  uint32_t            flags)
+{
+	STACK_CHECK(0x220);
+	if (!check_timeout_pointer(timeout))
+	{
+		return nullptr;
+	}
+	LockGuard g{lock};
+	auto     *cap = malloc_capability_unseal(heapCapability);
+	if (cap == nullptr)
+	{
+		return nullptr;
+	}
+	// Use the default memory space.
+	size_t req;
+	if (__builtin_mul_overflow(nElements, elemSize, &req))
+	{
+		return nullptr;
+	}
+	if (!check_pointer<PermissionSet{Permission::Load, Permission::Store}>(
+	      timeout))
 	{
-		if (chunk->is_in_use() && !chunk->isSealedObject)
-		{
-			auto size = chunk->size_get();
-			if (heap_free_chunk(
-			      *capability, *chunk, gm->chunk_body_size(*chunk)) == 0)
-			{
-				freed += size;
-			}
-		}
-		chunk = static_cast<MChunkHeader *>(chunk->cell_next());
-	} while (chunk.address() < heapEnd);
-
-	// If there are any threads blocked allocating memory, wake them up.
-	if ((freeFutex > 0) && (freed > 0))
+		return nullptr;
+	}
+	void *ret = malloc_internal(req, std::move(g), cap, timeout, false, flags);
+	if (ret == nullptr)
 	{
-		Debug::log("Some threads are blocking on allocations, waking them");
-		freeFutex = 0;
-		freeFutex.notify_all();
+		trace_record(TraceOperation::Allocate, cap->identifier, req, 0, -ENOMEM);
 	}
-
-	return freed;
+	return ret;
 }
 
-__cheriot_minimum_stack(0x220) void *heap_allocate_array(
+__cheriot_minimum_stack(0x2a0) void *heap_resize(
   Timeout            *timeout,
   AllocatorCapability heapCapability,
-  size_t              nElements,
-  size_t              elemSize,
-  uint32_t            flags)
+  void               *pointer,
+  size_t              size)
 {
-	STACK_CHECK(0x220);
+	STACK_CHECK(0x2a0);
 	if (!check_timeout_pointer(timeout))
 	{
 		return nullptr;
@@ -1055,18 +2697,118 @@ __cheriot_minimum_stack(0x220) void *heap_allocate_array(
 	{
 		return nullptr;
 	}
-	// Use the default memory space.
-	size_t req;
-	if (__builtin_mul_overflow(nElements, elemSize, &req))
+	// `malloc_internal` may drop the lock and another thread may free the
+	// object in the meantime.  Reload the pointer from memory, so that the
+	// load barrier invalidates it if it has been freed, and recheck it each
+	// time that it is used.
+	void *volatile pointerSlot = pointer;
+	auto           ownedChunk  = [&]() -> MChunkHeader * {
+		Capability<void> mem{pointerSlot};
+		if (!mem.is_valid())
+		{
+			return nullptr;
+		}
+		MState *region = heap_region_for(mem.address());
+		auto   *chunk  = region->allocation_start(mem.address());
+		// Only the owner may resize an object, with a pointer to the whole
+		// object.  Claims and sealed objects would need their recorded sizes
+		// to change.
+		if ((chunk == nullptr) || (chunk->owner() != cap->identifier) ||
+		    (chunk->claims != 0) || chunk->isSealedObject ||
+		    (chunk->body().address() != mem.base()) ||
+		    (region->chunk_body_size(*chunk) != mem.length()))
+		{
+			return nullptr;
+		}
+		return chunk;
+	};
+	MChunkHeader *chunk = ownedChunk();
+	if (chunk == nullptr)
 	{
 		return nullptr;
 	}
-	if (!check_pointer<PermissionSet{Permission::Load, Permission::Store}>(
-	      timeout))
+	size_t alignSize =
+	  (CHERI::representable_length(size) + MallocAlignMask) & ~MallocAlignMask;
+	if (alignSize == 0)
+	{
+		return nullptr;
+	}
+	MState   *region  = heap_region_for(chunk->body().address());
+	size_t    oldSize = region->chunk_body_size(*chunk);
+	ptraddr_t base    = chunk->body().address();
+	if (alignSize == oldSize)
+	{
+		return pointer;
+	}
+
+	// Growing in place needs the new bounds to be representable with the
+	// existing base.  Old pointers keep their old bounds, so nothing needs to
+	// be revoked.  Shrinking in place is not safe: old pointers would keep
+	// access to the tail after it is reused, and they cannot be revoked
+	// without also revoking the new pointer, which has the same base.
+	if ((alignSize > oldSize) && CHERI::is_precise_range(base, alignSize) &&
+	    region->mspace_extend(*chunk, alignSize, cap->quota))
+	{
+		quota_low_water_update(*cap);
+		Capability<void> body{region->heapStart};
+		body.address() = base;
+		body.bounds()  = region->chunk_body_size(*chunk);
+		trace_record(TraceOperation::Free, cap->identifier, 0, base, 0);
+		trace_record(TraceOperation::Allocate, cap->identifier, size, base, 0);
+		return body;
+	}
+
+	void *ret = malloc_internal(size, std::move(g), cap, timeout);
+	if (ret == nullptr)
 	{
+		trace_record(
+		  TraceOperation::Allocate, cap->identifier, size, 0, -ENOMEM);
 		return nullptr;
 	}
-	return malloc_internal(req, std::move(g), cap, timeout, false, flags);
+	chunk = ownedChunk();
+	if (chunk == nullptr)
+	{
+		heap_free_pointer(*cap, ret, true);
+		return nullptr;
+	}
+	memcpy(ret,
+	       pointerSlot,
+	       std::min(size, heap_region_for(base)->chunk_body_size(*chunk)));
+	int freed = heap_free_pointer(*cap, pointerSlot, true);
+	Debug::Assert(freed == 0, "Failed to free resized object: {}", freed);
+	allocation_waiters_wake();
+	housekeeping_wake();
+	return ret;
+}
+
+__cheriot_minimum_stack(0x290) int heap_allocate_batch(
+  Timeout            *timeout,
+  AllocatorCapability heapCapability,
+  size_t              size,
+  size_t              count,
+  void              **out,
+  uint32_t            flags)
+{
+	STACK_CHECK(0x290);
+	return heap_allocate_batch_internal(
+	  timeout, heapCapability, size, nullptr, count, out, flags);
+}
+
+__cheriot_minimum_stack(0x290) int heap_allocate_batch_sizes(
+  Timeout            *timeout,
+  AllocatorCapability heapCapability,
+  const size_t       *sizes,
+  size_t              count,
+  void              **out,
+  uint32_t            flags)
+{
+	STACK_CHECK(0x290);
+	if (sizes == nullptr)
+	{
+		return -EINVAL;
+	}
+	return heap_allocate_batch_internal(
+	  timeout, heapCapability, 0, sizes, count, out, flags);
 }
 
 namespace
@@ -1149,8 +2891,14 @@ namespace
 		{
 			return {nullptr, nullptr};
 		}
-		SealedAllocation obj{static_cast<SObjStruct *>(malloc_internal(
-		  sealedSize, std::move(g), capability, timeout, true))};
+		void *allocation =
+		  sealed_object_cache_reuse(*capability, key.address(), sealedSize);
+		if (allocation == nullptr)
+		{
+			allocation = malloc_internal(
+			  sealedSize, std::move(g), capability, timeout, true);
+		}
+		SealedAllocation obj{static_cast<SObjStruct *>(allocation)};
 		if (obj == nullptr)
 		{
 			Debug::log<DebugLevel::Warning>(
@@ -1282,12 +3030,22 @@ __cheriot_minimum_stack(0x260) int token_obj_destroy(
 	void *unsealed;
 	{
 		LockGuard g{lock};
-		unsealed = unseal_internal(
+		SealedAllocation obj = unseal_internal(
 		  key, reinterpret_cast<CHERI_SEALED(SObjStruct *)>(object));
-		if (unsealed == nullptr)
+		if (obj == nullptr)
 		{
 			return -EINVAL;
 		}
+		// Keep the object for reuse by the next allocation with this key, if
+		// we can.
+		auto *capability = malloc_capability_unseal(heapCapability);
+		if ((capability != nullptr) &&
+		    sealed_object_cache_retire(*capability, obj))
+		{
+			allocation_waiters_wake();
+			return 0;
+		}
+		unsealed = obj;
 		// At this point, we drop and reacquire the lock. This is better for
 		// code reuse and heap_free will catch races because it will check the
 		// revocation state.
@@ -1321,15 +3079,511 @@ __cheriot_minimum_stack(0xf0) int token_obj_can_destroy(
 	return heap_can_free(heapCapability, unsealed);
 }
 
+/**
+ * The state of a pool created by `heap_pool_create`.  This is the contents of
+ * the sealed allocation that backs the pool.  It is followed by a bitmap of
+ * the objects that are allocated and then by the objects themselves.
+ */
+struct HeapPoolState
+{
+	/**
+	 * The offset of the first object from the start of this structure.  A
+	 * capability to the objects is not stored because its base is the first
+	 * object, so painting that object's shadow bits when it is freed would
+	 * invalidate it.
+	 */
+	uint32_t objectsOffset;
+	/**
+	 * The size of each object.  This is also the distance between objects,
+	 * so every object can be given precise bounds.
+	 */
+	uint32_t objectSize;
+	/// The number of objects in the pool.
+	uint16_t objectCount;
+	/// The number of objects that are currently allocated.
+	uint16_t allocatedCount;
+	/**
+	 * The list of free objects that have been through revocation and can be
+	 * reused, as an object index plus one, or zero if the list is empty.
+	 */
+	uint16_t readyHead;
+	/**
+	 * The list of freed objects that are waiting for revocation, oldest first,
+	 * in the same encoding as `readyHead`.
+	 */
+	uint16_t pendingHead;
+	/// The last object in the pending list.
+	uint16_t pendingTail;
+	/// Bitmap of the objects that are currently allocated.
+	uint32_t allocated[];
+};
+
+namespace
+{
+	/**
+	 * The header written into the start of a free pool object.  The rest of
+	 * the object is zero.
+	 */
+	struct PoolFreeObject
+	{
+		/// The revocation epoch that must finish before this is reused.
+		uint32_t epoch;
+		/// The next object in the list, as an object index plus one.
+		uint16_t next;
+	};
+
+	/**
+	 * The smallest pool object.  Free objects hold a `PoolFreeObject` at the
+	 * start and must end with a zero granule.  `allocation_start` relies on
+	 * this to skip over pending objects, whose shadow bits are painted, when
+	 * it looks for the pool's chunk header from a live object after them.
+	 */
+	constexpr size_t PoolMinimumObjectSize = 2 * MallocAlignment;
+
+	/**
+	 * Returns a capability to all of the objects in `pool`.  The bounds are
+	 * precise, so they may extend past the last object.  Objects are indexed
+	 * from the address (which is also the base) of this capability.
+	 */
+	Capability<void> pool_objects(HeapPoolState *pool)
+	{
+		Capability<void> objects{pool};
+		objects.address() += pool->objectsOffset;
+		objects.bounds() = CHERI::representable_length(
+		  static_cast<size_t>(pool->objectSize) * pool->objectCount);
+		return objects;
+	}
+
+	/**
+	 * Returns a capability to object `index` in `pool`.
+	 */
+	Capability<void> pool_object(HeapPoolState *pool, size_t index)
+	{
+		Capability<void> object = pool_objects(pool);
+		object.address() += index * pool->objectSize;
+		object.bounds() = pool->objectSize;
+		return object;
+	}
+
+	/**
+	 * Returns the free-list header of object `index` in `pool`.
+	 */
+	PoolFreeObject *pool_free_object(HeapPoolState *pool, size_t index)
+	{
+		return pool_object(pool, index).cast<PoolFreeObject>();
+	}
+
+	/**
+	 * Unseal a pool handle.  Returns null if `pool` is not a valid pool or if
+	 * the pool has been destroyed.
+	 */
+	HeapPoolState *pool_unseal(HeapPool pool)
+	{
+		SealedAllocation obj = unseal_internal(
+		  STATIC_SEALING_TYPE(HeapPoolKey),
+		  reinterpret_cast<CHERI_SEALED(SObjStruct *)>(pool));
+		if (obj == nullptr)
+		{
+			return nullptr;
+		}
+		// A destroyed pool is in quarantine, or has been reused, until its
+		// handle has been revoked.
+		Capability<HeapPoolState> state{
+		  reinterpret_cast<HeapPoolState *>(obj->data)};
+		if (revoker.shadow_bit_get(state.address()))
+		{
+			return nullptr;
+		}
+		return state;
+	}
+
+	/**
+	 * Move the objects in `pool` whose revocation has finished from the
+	 * pending list to the ready list.  This clears their shadow bits, so
+	 * that new capabilities to them are not invalidated.
+	 */
+	void pool_pending_promote(HeapPoolState *pool)
+	{
+		while (pool->pendingHead != 0)
+		{
+			size_t          index = pool->pendingHead - 1;
+			PoolFreeObject *free  = pool_free_object(pool, index);
+			if (!revoker.has_revocation_finished_for_epoch(free->epoch))
+			{
+				return;
+			}
+			pool->pendingHead = free->next;
+			if (pool->pendingHead == 0)
+			{
+				pool->pendingTail = 0;
+			}
+			Capability object = pool_object(pool, index);
+			revoker.shadow_paint_range<false>(object.base(), object.top());
+			free->next      = pool->readyHead;
+			pool->readyHead = index + 1;
+		}
+	}
+} // namespace
+
+__cheriot_minimum_stack(0x290) HeapPool
+  heap_pool_create(Timeout            *timeout,
+                   AllocatorCapability heapCapability,
+                   size_t              objectSize,
+                   size_t              count)
+{
+	STACK_CHECK(0x290);
+	if ((count == 0) || (count >= UINT16_MAX) ||
+	    (objectSize > UINT32_MAX / count))
+	{
+		return nullptr;
+	}
+	// Round the object size up so that every object is aligned and can have
+	// precise bounds.
+	objectSize = std::max(objectSize, PoolMinimumObjectSize);
+	objectSize = (objectSize + MallocAlignMask) & ~MallocAlignMask;
+	objectSize = CHERI::representable_length(objectSize);
+	size_t headerSize =
+	  sizeof(HeapPoolState) + ((count + 31) / 32) * sizeof(uint32_t);
+	size_t objectsSize;
+	if ((objectSize == 0) ||
+	    __builtin_mul_overflow(objectSize, count, &objectsSize))
+	{
+		return nullptr;
+	}
+	// The capability to all of the objects must also have precise bounds,
+	// which, for large pools, needs stronger alignment and padding than each
+	// object does.  Objects are at multiples of a representable length from
+	// the start, so they remain precisely representable.
+	objectsSize = CHERI::representable_length(objectsSize);
+	size_t alignment =
+	  std::max<size_t>(~CHERI::representable_alignment_mask(objectsSize) + 1,
+	                   MallocAlignment);
+	size_t size;
+	if ((objectsSize == 0) ||
+	    __builtin_add_overflow(
+	      headerSize + alignment - MallocAlignment, objectsSize, &size))
+	{
+		return nullptr;
+	}
+
+	auto [sealed, obj] =
+	  allocate_sealed_unsealed(timeout,
+	                           heapCapability,
+	                           STATIC_SEALING_TYPE(HeapPoolKey),
+	                           size,
+	                           {Permission::Seal});
+	if (obj == nullptr)
+	{
+		return nullptr;
+	}
+	LockGuard                 g{lock};
+	Capability<HeapPoolState> pool{static_cast<HeapPoolState *>(obj)};
+	Capability<void>          objects{obj};
+	objects.address() += headerSize;
+	objects.align_up(alignment);
+	Debug::Assert(CHERI::is_precise_range(objects.address(), objectsSize),
+	              "Pool objects at {} cannot have precise bounds of length {}",
+	              objects,
+	              objectsSize);
+	pool->objectsOffset  = objects.address() - pool.address();
+	pool->objectSize     = objectSize;
+	pool->objectCount    = count;
+	pool->allocatedCount = 0;
+	// The allocation is zeroed, so each object's `PoolFreeObject` needs only
+	// its link.  None of them needs revocation before its first use.
+	for (size_t i = 0; i < count; i++)
+	{
+		pool_free_object(pool, i)->next = (i + 1 < count) ? i + 2 : 0;
+	}
+	pool->readyHead   = 1;
+	pool->pendingHead = 0;
+	pool->pendingTail = 0;
+	return reinterpret_cast<HeapPool>(sealed);
+}
+
+__cheriot_minimum_stack(0x1c0) void *heap_pool_allocate(Timeout *timeout,
+                                                        HeapPool pool)
+{
+	STACK_CHECK(0x1c0);
+	if (!check_timeout_pointer(timeout))
+	{
+		return nullptr;
+	}
+	LockGuard g{lock, timeout};
+	if (!g)
+	{
+		return nullptr;
+	}
+	while (true)
+	{
+		// Unseal on each attempt because the pool may have been destroyed
+		// while we were waiting without the lock.
+		HeapPoolState *state = pool_unseal(pool);
+		if (state == nullptr)
+		{
+			return nullptr;
+		}
+		pool_pending_promote(state);
+		if (state->readyHead != 0)
+		{
+			size_t          index = state->readyHead - 1;
+			PoolFreeObject *free  = pool_free_object(state, index);
+			state->readyHead      = free->next;
+			*free                 = {};
+			state->allocated[index / 32] |= 1U << (index % 32);
+			state->allocatedCount++;
+			return pool_object(state, index);
+		}
+		// If every object is allocated, waiting for revocation won't help.
+		if ((state->pendingHead == 0) || !may_block(timeout))
+		{
+			return nullptr;
+		}
+		uint32_t epoch =
+		  pool_free_object(state, state->pendingHead - 1)->epoch;
+		revoker.system_bg_revoker_kick();
+		if (!wait_for_background_revoker(timeout, epoch, g))
+		{
+			return nullptr;
+		}
+	}
+}
+
+__cheriot_minimum_stack(0x150) int heap_pool_free(HeapPool pool, void *object)
+{
+	STACK_CHECK(0x150);
+	LockGuard      g{lock};
+	HeapPoolState *state = pool_unseal(pool);
+	if (state == nullptr)
+	{
+		return -EPERM;
+	}
+	Capability<void> capability{object};
+	Capability<void> objects = pool_objects(state);
+	if (!capability.is_valid() || !capability.is_subset_of(objects))
+	{
+		return -EINVAL;
+	}
+	// Objects are indexed from the address of `objects`, as in
+	// `pool_object`.  Its bounds may extend past the last object.
+	size_t offset = capability.address() - objects.address();
+	size_t index  = offset / state->objectSize;
+	// Only the precise capabilities returned by `heap_pool_allocate` can free
+	// an object.
+	if ((capability.base() != capability.address()) ||
+	    (capability.address() < objects.address()) ||
+	    (offset % state->objectSize != 0) ||
+	    (index >= state->objectCount) ||
+	    (capability.length() != state->objectSize))
+	{
+		return -EINVAL;
+	}
+	uint32_t bit = 1U << (index % 32);
+	if ((state->allocated[index / 32] & bit) == 0)
+	{
+		return -EINVAL;
+	}
+
+	Capability<void> freed = pool_object(state, index);
+	{
+		// An object on a live hazard list must stay valid and unmodified
+		// until the claim lapses.  It cannot be captured in the hazard
+		// quarantine like a heap chunk, because that frees whole chunks, so
+		// refuse to free it for now.
+		MState *region = heap_region_for(freed.address());
+		auto    guard  = region->hazard_list_begin();
+		region->hazard_pointers_snapshot();
+		if (region->hazard_pointer_check(freed))
+		{
+			return -EBUSY;
+		}
+		// Paint the shadow bits so that loads of any remaining capabilities
+		// to the object are invalidated until revocation has removed them.
+		// As in `hazard_check_and_paint`, this must happen before zeroing,
+		// or a store through a stale capability could undo the zeroing.
+		revoker.shadow_paint_range<true>(freed.base(), freed.top());
+	}
+	state->allocated[index / 32] &= ~bit;
+	state->allocatedCount--;
+
+	// The object is reused only once the current revocation epoch has
+	// finished, as for chunks in the heap's quarantine.
+	memset(freed.get(), 0, state->objectSize);
+	uint32_t epoch = revoker.system_epoch_get();
+	epoch += epoch & 1;
+	*pool_free_object(state, index) = {epoch, 0};
+	if (state->pendingTail == 0)
+	{
+		state->pendingHead = index + 1;
+	}
+	else
+	{
+		pool_free_object(state, state->pendingTail - 1)->next = index + 1;
+	}
+	state->pendingTail = index + 1;
+	return 0;
+}
+
+__cheriot_minimum_stack(0x260) int heap_pool_destroy(
+  AllocatorCapability heapCapability,
+  HeapPool            pool)
+{
+	STACK_CHECK(0x260);
+	void *unsealed;
+	{
+		LockGuard g{lock};
+		if (pool_unseal(pool) == nullptr)
+		{
+			return -EINVAL;
+		}
+		unsealed = unseal_internal(
+		  STATIC_SEALING_TYPE(HeapPoolKey),
+		  reinterpret_cast<CHERI_SEALED(SObjStruct *)>(pool));
+	}
+	// Freeing the whole allocation paints and revokes every object in the
+	// pool, including any that are still allocated.
+	return heap_free_nostackcheck(heapCapability, unsealed);
+}
+
 size_t heap_available()
 {
-	return gm->heapFreeSize;
+	return heap_free_size();
+}
+
+__cheriot_minimum_stack(0xc0) int heap_stats(
+  AllocatorCapability heapCapability,
+  struct HeapStats   *stats)
+{
+	STACK_CHECK(0xc0);
+	if (!check_pointer<PermissionSet{Permission::Store}>(stats,
+	                                                     sizeof(*stats)))
+	{
+		return -EINVAL;
+	}
+	LockGuard g{lock};
+	auto     *capability = malloc_capability_unseal(heapCapability);
+	if (capability == nullptr)
+	{
+		return -EPERM;
+	}
+	check_gm();
+
+	static_assert(std::extent_v<decltype(HeapStats::smallBinChunks)> ==
+	              NSmallBins);
+	static_assert(std::extent_v<decltype(HeapStats::treeBinChunks)> ==
+	              NTreeBins);
+	auto failures = [](MState::AllocationResult failure) {
+        return allocationFailureCounts[failure.index()];
+	};
+
+	// Report the totals over all heap regions.
+	*stats = {};
+	heap_regions_each([&](MState &state) {
+		stats->freeBytes += state.heapFreeSize;
+		stats->quarantinedBytes += state.heapQuarantineSize;
+		stats->inUseBytes += state.heapTotalSize - state.heapFreeSize -
+		                     state.heapQuarantineSize;
+		stats->largestFreeChunk =
+		  std::max(stats->largestFreeChunk, state.largest_free_chunk());
+		for (size_t i = 0; i < NSmallBins; i++)
+		{
+			stats->smallBinChunks[i] += state.smallbinChunkCounts[i];
+		}
+		for (size_t i = 0; i < NTreeBins; i++)
+		{
+			stats->treeBinChunks[i] += state.treebinChunkCounts[i];
+		}
+	});
+#if ALLOCATOR_SEALED_CACHE
+	// Cached sealed objects are still marked in use, but are not allocated
+	// to anyone.
+	for (auto &entry : sealedObjectCache)
+	{
+		if (entry.chunk != nullptr)
+		{
+			stats->cachedBytes += entry.chunk->size_get();
+		}
+	}
+	stats->inUseBytes -= stats->cachedBytes;
+#endif
+	stats->quotaRemaining = capability->quota;
+	stats->quotaLowWater  = capability->quotaLowWater;
+	stats->failuresPermanent =
+	  failures(MState::AllocationFailurePermanent{});
+	stats->failuresRevocationNeeded =
+	  failures(MState::AllocationFailureRevocationNeeded{});
+	stats->failuresQuotaExceeded =
+	  failures(MState::AllocationFailureQuotaExceeded{});
+	stats->failuresHeapFull = failures(MState::AllocationFailureHeapFull{});
+	// Epochs are odd while revocation is in progress.
+	stats->revocationEpochs = revoker.system_epoch_get() / 2;
+	return 0;
 }
 
 [[cheriot::interrupt_state(disabled)]] int heap_render()
 {
 #if HEAP_RENDER
-	gm->render();
+	heap_regions_each([](MState &state) { state.render(); });
+#endif
+	return 0;
+}
+
+__cheriot_minimum_stack(0xc0) int heap_trace_dump()
+{
+	STACK_CHECK(0xc0);
+#if ALLOCATOR_TRACE
+	LockGuard g{lock};
+	uint32_t  written = traceWritten.load();
+	uint32_t  first   = traceDumped;
+	// If the ring has wrapped since the last dump, the oldest records that we
+	// haven't printed have been overwritten.
+	if (written - first > TraceRecords)
+	{
+		first = written - TraceRecords;
+	}
+	TraceDebug::log("alloctrace-begin {} {}", written, first - traceDumped);
+	for (uint32_t i = first; i != written; i++)
+	{
+		TraceRecord &record = traceRing[i % TraceRecords];
+		TraceDebug::log("alloctrace {} {} {} {} {} {}",
+		                record.timestamp,
+		                static_cast<uint32_t>(record.operation),
+		                record.owner,
+		                record.size,
+		                record.address,
+		                static_cast<int32_t>(record.result));
+	}
+	TraceDebug::log("alloctrace-end");
+	traceDumped = written;
+#endif
+	return 0;
+}
+
+__cheriot_minimum_stack(0xc0) int heap_snapshot_dump()
+{
+	STACK_CHECK(0xc0);
+#if ALLOCATOR_SNAPSHOT
+	using SnapshotDebug = ConditionalDebug<true, "Allocator snapshot">;
+	LockGuard g{lock};
+	SnapshotDebug::log("heapsnap-begin");
+	heap_regions_each([](MState &state) {
+		SnapshotDebug::log("heapsnap-region {} {}",
+		                   state.heapStart.base(),
+		                   state.heapStart.top());
+		state.snapshot([](ptraddr_t            address,
+		                  size_t               size,
+		                  MState::SnapshotState chunkState,
+		                  uint16_t             owner,
+		                  bool                 isSealed) {
+			SnapshotDebug::log("heapsnap {} {} {} {} {}",
+			                   address,
+			                   size,
+			                   static_cast<uint32_t>(chunkState),
+			                   owner,
+			                   static_cast<uint32_t>(isSealed));
+		});
+	});
+	SnapshotDebug::log("heapsnap-end");
 #endif
 	return 0;
 }
@@ -32,8 +32,9 @@ namespace Revocation
 	 * shadow memory, and the base address of the memory covered by the shadow
 	 * bitmap.
 	 *
-	 * This currently assumes that all revocable memory is in a single
-	 * contiguous region.
+	 * This assumes that all revocable memory, including every heap region,
+	 * is in a single contiguous window that starts at `TCMBaseAddr`.  Heap
+	 * regions do not need to be adjacent, but each must be inside the window.
 	 */
 	template<typename WordT, size_t TCMBaseAddr>
 	class Bitmap
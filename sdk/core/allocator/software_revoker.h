@@ -4,6 +4,15 @@
 #include <cdefs.h>
 #include <stdint.h>
 
+/**
+ * The maximum number of memory ranges that the software revoker sweeps.  The
+ * loader provides the revoker with a capability to each range of memory that
+ * can hold capabilities (the stacks, the globals and main heap, and each
+ * additional heap region), so this limits the number of heap regions that a
+ * board can declare when it uses the software revoker.
+ */
+#define SOFTWARE_REVOKER_MAX_SCAN_RANGES 8
+
 /**
  * Prod the software revoker to do some work.  This does not do a complete
  * revocation pass; it will scan a region of memory and then return.
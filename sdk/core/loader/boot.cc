@@ -10,6 +10,7 @@
 #define __cheri_libcall
 #include <string.h>
 
+#include "../allocator/software_revoker.h"
 #include "../switcher/tstack.h"
 #include "constants.h"
 #include "debug.hh"
@@ -23,6 +24,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <switcher.h>
 
 using namespace CHERI;
 
@@ -534,6 +536,24 @@ namespace
 						              heap);
 						return heap;
 					}
+#ifdef CHERIOT_HEAP_REGIONS
+					// Any additional heap regions that the board declares
+					// must be imported whole.  The gaps between them may
+					// contain other devices, so only an exact match for a
+					// declared region is granted.
+#	define CHERIOT_HEAP_REGION(name, preferredMaxAllocation)                  \
+		if ((entry.address == LA_ABS(__export_mem_##name)) &&                  \
+		    (entry.address + entry.size() ==                                   \
+		     LA_ABS(__export_mem_##name##_end)))                               \
+		{                                                                      \
+			Debug::log("Assigning heap region {}--{} to the allocator",        \
+			           entry.address,                                          \
+			           entry.address + entry.size());                          \
+			return build(entry.address, entry.size());                         \
+		}
+					CHERIOT_HEAP_REGIONS
+#	undef CHERIOT_HEAP_REGION
+#endif
 				}
 			}
 			// MMIO regions should be within the range of the MMIO space.  As a
@@ -840,9 +860,10 @@ namespace
 	 */
 	void boot_threads_create(const ImgHdr &image, ThreadLoaderInfo *threadInfo)
 	{
-		// Two hazard pointers per thread.  More makes free slow, fewer is hard
-		// to use.
-		static constexpr size_t HazardPointersPerThread = 2;
+		// Hazard pointers per thread, configured at build time (at least two).
+		// More makes free and cross-compartment calls slow, fewer is hard to
+		// use.
+		static constexpr size_t HazardPointersPerThread = CHERIOT_HAZARD_SLOTS;
 		Capability<void *>      hazardPointers =
 		  build<void *,
 		        Root::Type::RWGlobal,
@@ -1421,16 +1442,19 @@ extern "C" SchedulerEntryInfo loader_entry_point(const ImgHdr &imgHdr,
 	// location, with interrupts disabled, to trigger the load barrier).
 
 	// The scary capabilities are stored at the beginning of the software
-	// revoker compartment. At the moment we only need one.
+	// revoker compartment, one for each range of memory that can hold
+	// capabilities.  Code, read-only data, MMIO, and any gaps between heap
+	// regions cannot, so the revoker does not need to sweep them.
 	auto scaryCapabilities = build<Capability<void>,
 	                               Root::Type::RWStoreL,
 	                               Root::Permissions<Root::Type::RWStoreL>,
 	                               /* Precise: */ true>(
 	  imgHdr.privilegedCompartments.software_revoker().code.start(),
-	  sizeof(void *));
+	  SOFTWARE_REVOKER_MAX_SCAN_RANGES * sizeof(void *));
 	Debug::log("Writing scary capabilities for software revoker to {}",
 	           scaryCapabilities);
-	// Construct a capability to all RW globals, stacks and heap.
+	size_t scanRanges = 0;
+	// Construct a capability to a range that the revoker must sweep.
 	// We use an imprecise set-bounds operation here because we need to ensure
 	// that the region is completely scanned and scanning slightly more is
 	// not a problem unless the revoker is compromised.  The software revoker
@@ -1439,16 +1463,31 @@ extern "C" SchedulerEntryInfo loader_entry_point(const ImgHdr &imgHdr,
 	// Given that hardware revokers are lower power, faster, and more secure,
 	// there's little reason for the software revoker to be used for anything
 	// other than testing.
-	scaryCapabilities[0] = build<void,
-	                             Root::Type::RWStoreL,
-	                             Root::Permissions<Root::Type::RWStoreL>,
-	                             /* Precise: */ false>(
-	  LA_ABS(__revoker_scan_start),
-	  LA_ABS(__export_mem_heap_end) - LA_ABS(__revoker_scan_start));
-	scaryCapabilities[0].address() = scaryCapabilities[0].base();
-	Debug::log("Wrote scary cap[0]={} requested_start={}",
-	           scaryCapabilities[0],
-	           LA_ABS(__revoker_scan_start));
+	auto addScanRange = [&](ptraddr_t start, ptraddr_t end) {
+		Debug::Invariant(scanRanges < SOFTWARE_REVOKER_MAX_SCAN_RANGES,
+		                 "Too many ranges for the software revoker to sweep");
+		Capability<void> range = build<void,
+		                               Root::Type::RWStoreL,
+		                               Root::Permissions<Root::Type::RWStoreL>,
+		                               /* Precise: */ false>(start,
+		                                                      end - start);
+		range.address()                 = range.base();
+		scaryCapabilities[scanRanges++] = range;
+		Debug::log("Software revoker will sweep {}", range);
+	};
+	// The stacks and trusted stacks.
+	addScanRange(LA_ABS(__revoker_scan_start), LA_ABS(__stack_space_end));
+	// All globals, sealed objects, shared objects, and the main heap.
+	addScanRange(LA_ABS(__compart_cgps), LA_ABS(__export_mem_heap_end));
+	// Each additional heap region.
+#	ifdef CHERIOT_HEAP_REGIONS
+#		define CHERIOT_HEAP_REGION(name, preferredMaxAllocation)              \
+			addScanRange(LA_ABS(__export_mem_##name),                          \
+			             LA_ABS(__export_mem_##name##_end));
+	CHERIOT_HEAP_REGIONS
+#		undef CHERIOT_HEAP_REGION
+#	endif
+	// Any remaining slots are left null, which the revoker skips.
 #endif
 
 	// Set up the exception entry point
@@ -30,6 +30,19 @@ namespace
 #endif
 	  ;
 
+	/**
+	 * Is tickless idle enabled?  If so, yielding threads are not woken early
+	 * when no other thread is runnable and the system instead stays idle until
+	 * the next timeout.
+	 */
+	constexpr bool Tickless =
+#ifdef SCHEDULER_TICKLESS
+	  SCHEDULER_TICKLESS
+#else
+	  false
+#endif
+	  ;
+
 	using Debug = ConditionalDebug<DebugScheduler, "Scheduler">;
 
 	constexpr StackCheckMode StackMode =
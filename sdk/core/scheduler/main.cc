@@ -42,14 +42,54 @@ int scheduler_simulation_exit(uint32_t code)
  */
 static uint64_t cyclesAtLastSchedulingEvent;
 
+/**
+ * The number of timer interrupts that the scheduler has handled.
+ */
+static uint64_t timerInterrupts;
+
 namespace
 {
 	constexpr bool UseMultiwaiters = SCHEDULER_MULTIWAITER;
 
 	/**
-	 * Priority-sorted list of threads waiting for a futex.
+	 * The number of lists that futex waiters are hashed into.  Each thread
+	 * records the lists that contain threads boosting its priority in a
+	 * bitmap, so this must not exceed the width of that bitmap.
+	 */
+	constexpr size_t FutexBuckets = 16;
+	static_assert((FutexBuckets & (FutexBuckets - 1)) == 0,
+	              "The number of futex buckets must be a power of two");
+	static_assert(
+	  FutexBuckets <=
+	    std::numeric_limits<decltype(Thread::futexBoostingBuckets)>::digits,
+	  "Too many futex buckets for the per-thread boosting bitmap");
+
+	/**
+	 * Priority-sorted lists of threads waiting for a futex, indexed by a hash
+	 * of the futex address.  Every operation on a futex needs to walk only
+	 * the list for that address, which contains the waiters on that futex and
+	 * on any other futex whose address has the same hash.
+	 */
+	Thread *futexWaitingLists[FutexBuckets];
+
+	/**
+	 * Returns the index in `futexWaitingLists` of the list for the futex at
+	 * `key`.  Futex words are normally 4-byte aligned, so the low bits are
+	 * discarded and some higher bits folded in so that futexes in adjacent
+	 * objects land in different buckets.
 	 */
-	Thread *futexWaitingList;
+	size_t futex_bucket(ptraddr_t key)
+	{
+		return ((key >> 2) ^ (key >> 6) ^ (key >> 10)) & (FutexBuckets - 1);
+	}
+
+	/**
+	 * Returns the list of threads waiting for the futex at `key`.
+	 */
+	Thread *&futex_waiting_list(ptraddr_t key)
+	{
+		return futexWaitingLists[futex_bucket(key)];
+	}
 
 	/**
 	 * The value used for priority-boosting futexes that are not actually
@@ -62,20 +102,40 @@ namespace
 	 * Returns the boosted priority provided by waiters on a futex.
 	 *
 	 * This finds the maximum priority of all threads that are priority
-	 * boosting the thread identified by `threadID`.  Callers may be about to
-	 * add a new thread to that list and so another priority can be provided,
-	 * which will be used if it is larger than any of the priorities of the
-	 * other waiters.
+	 * boosting `owner`.  Callers may be about to add a new thread to that list
+	 * and so another priority can be provided, which will be used if it is
+	 * larger than any of the priorities of the other waiters.
+	 *
+	 * Only the lists recorded in the owner's boosting bitmap are walked.  Each
+	 * list is sorted by priority, so the walk stops at the first thread
+	 * boosting the owner.  Lists that no longer contain any threads boosting
+	 * the owner are removed from the bitmap.
 	 */
-	uint8_t priority_boost_for_thread(uint16_t threadID, uint8_t priority = 0)
+	uint8_t priority_boost_for_thread(Thread *owner, uint8_t priority = 0)
 	{
-		Thread::walk_thread_list(futexWaitingList, [&](Thread *thread) {
-			if ((thread->futexPriorityInheriting) &&
-			    (thread->futexPriorityBoostedThread == threadID))
+		uint16_t threadID = owner->id_get();
+		auto     buckets  = owner->futexBoostingBuckets;
+		while (buckets != 0)
+		{
+			size_t bucket = ctz(buckets);
+			buckets &= buckets - 1;
+			bool found = false;
+			Thread::walk_thread_list(
+			  futexWaitingLists[bucket],
+			  [&](Thread *thread) {
+				  if ((thread->futexPriorityInheriting) &&
+				      (thread->futexPriorityBoostedThread == threadID))
+				  {
+					  priority = std::max(priority, thread->priority_get());
+					  found    = true;
+				  }
+			  },
+			  [&]() { return found; });
+			if (!found)
 			{
-				priority = std::max(priority, thread->priority_get());
+				owner->futexBoostingBuckets &= ~(1U << bucket);
 			}
-		});
+		}
 		return priority;
 	}
 
@@ -85,9 +145,9 @@ namespace
 	 */
 	void priority_boost_update(ptraddr_t key, uint16_t threadID)
 	{
-		Thread::walk_thread_list(futexWaitingList, [&](Thread *thread) {
+		Thread::walk_thread_list(futex_waiting_list(key), [&](Thread *thread) {
 			if ((thread->futexPriorityInheriting) &&
-			    (thread->futexWaitAddress = key))
+			    (thread->futexWaitAddress == key))
 			{
 				thread->futexPriorityBoostedThread = threadID;
 			}
@@ -106,9 +166,9 @@ namespace
 	 */
 	void priority_boost_reset(ptraddr_t key, uint16_t threadID)
 	{
-		Thread::walk_thread_list(futexWaitingList, [&](Thread *thread) {
+		Thread::walk_thread_list(futex_waiting_list(key), [&](Thread *thread) {
 			if ((thread->futexPriorityInheriting) &&
-			    (thread->futexWaitAddress = key))
+			    (thread->futexWaitAddress == key))
 			{
 				if (thread->futexPriorityBoostedThread == threadID)
 				{
@@ -164,7 +224,7 @@ namespace
 		// success.
 		int woke = 0;
 		Thread::walk_thread_list(
-		  futexWaitingList,
+		  futex_waiting_list(key),
 		  [&](Thread *thread) {
 			  if (thread->futexWaitAddress == key)
 			  {
@@ -371,6 +431,7 @@ namespace
 		case MCAUSE_INTR | MCAUSE_MTIME:
 			schedNeeded = true;
 			tick        = true;
+			timerInterrupts++;
 			break;
 		case MCAUSE_INTR | MCAUSE_MEXTERN:
 			schedNeeded = false;
@@ -409,6 +470,7 @@ namespace
 		default:
 			sched_panic(mcause, mepc, mtval);
 	}
+	Timer::update_ticks();
 	if (tick || !Thread::any_ready())
 	{
 		Timer::expiretimers();
@@ -431,6 +493,7 @@ namespace
 // thread APIs
 SystickReturn __cheri_compartment("scheduler") thread_systemtick_get()
 {
+	Timer::update_ticks();
 	uint64_t      ticks = Thread::ticksSinceBoot;
 	uint32_t      hi    = ticks >> 32;
 	uint32_t      lo    = ticks;
@@ -454,6 +517,27 @@ __cheriot_minimum_stack(0x90) int __cheri_compartment("scheduler")
 	return 0;
 }
 
+[[cheriot::interrupt_state(disabled)]] uint64_t thread_timer_get()
+{
+	return Timer::time();
+}
+
+__cheriot_minimum_stack(0x90) int __cheri_compartment("scheduler")
+  thread_sleep_until(uint64_t deadline)
+{
+	STACK_CHECK(0x90);
+	if (deadline <= Timer::time())
+	{
+		return -ETIMEDOUT;
+	}
+	// Sleep with the deadline as the expiry time directly, rather than
+	// converting it to a timeout relative to now.  This is not a yielding
+	// sleep, so the thread is not woken early.
+	Thread::current_get()->suspend(deadline, nullptr);
+	yield();
+	return 0;
+}
+
 __cheriot_minimum_stack(0xb0) int futex_timed_wait(Timeout        *timeout,
                                                    const uint32_t *address,
                                                    uint32_t        expected,
@@ -505,11 +589,18 @@ __cheriot_minimum_stack(0xb0) int futex_timed_wait(Timeout        *timeout,
 		// If other threads are boosting either the wrong thread or are
 		// priority boosting but haven't managed to acquire the lock, update
 		// their target.
+		// Record that the owner is boosted by threads in this futex's list,
+		// so that recalculating its priority will find them.
+		uint16_t bucketBit = 1U << futex_bucket(key);
 		priority_boost_update(key, owningThreadID);
+		owningThread->futexBoostingBuckets |= bucketBit;
 		owningThread->priority_boost(priority_boost_for_thread(
-		  owningThreadID, currentThread->priority_get()));
+		  owningThread, currentThread->priority_get()));
+		// The recalculation clears the bit if no other thread in the list is
+		// boosting the owner, but this thread is about to join it.
+		owningThread->futexBoostingBuckets |= bucketBit;
 	}
-	currentThread->suspend(timeout, &futexWaitingList);
+	currentThread->suspend(timeout, &futex_waiting_list(key));
 	bool timedout                   = currentThread->futexWaitAddress == 0;
 	currentThread->futexWaitAddress = 0;
 	if (isPriorityInheriting)
@@ -518,7 +609,7 @@ __cheriot_minimum_stack(0xb0) int futex_timed_wait(Timeout        *timeout,
 		           owningThread->id_get(),
 		           currentThread->id_get());
 		// Recalculate the priority boost from the remaining waiters, if any.
-		owningThread->priority_boost(priority_boost_for_thread(owningThreadID));
+		owningThread->priority_boost(priority_boost_for_thread(owningThread));
 	}
 	// If we woke up from a timer, report timeout.
 	if (timedout)
@@ -589,8 +680,7 @@ __cheriot_minimum_stack(0xc0) int futex_wake(uint32_t *address, uint32_t count)
 		// operation but two threads were blocked on a priority-inheriting
 		// futex, then we need to keep the priority boost from the other
 		// threads.
-		currentThread->priority_boost(
-		  priority_boost_for_thread(currentThread->id_get()));
+		currentThread->priority_boost(priority_boost_for_thread(currentThread));
 		// If we have dropped priority below that of another runnable thread, we
 		// should yield now.
 	}
@@ -776,6 +866,11 @@ uint16_t thread_count()
 	return CONFIG_THREADS_NUM;
 }
 
+[[cheriot::interrupt_state(disabled)]] uint64_t thread_timer_interrupt_count()
+{
+	return timerInterrupts;
+}
+
 #ifdef SCHEDULER_ACCOUNTING
 [[cheriot::interrupt_state(disabled)]] uint64_t thread_elapsed_cycles_idle()
 {
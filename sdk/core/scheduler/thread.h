@@ -64,8 +64,15 @@ namespace
 		 * disabled.
 		 */
 		static inline uint64_t ticksSinceBoot;
-		/// All threads that are suspended must be on this list.
-		static inline ThreadImpl *waitingList;
+
+		/**
+		 * Returns the suspended thread with the earliest expiry time, or
+		 * `nullptr` if no threads are suspended.
+		 */
+		static ThreadImpl *timer_heap_top()
+		{
+			return (timerHeapSize == 0) ? nullptr : timerHeap[0];
+		}
 
 		/// Returns the current running thread.
 		static ThreadImpl *current_get()
@@ -157,6 +164,10 @@ namespace
 		 * the timeout parameter before the call, but it will be updated only
 		 * if it is not freed by another thread during this call.
 		 *
+		 * Precise timeouts (those with a non-zero `remainingCycles`) expire at
+		 * an exact time, rather than at a tick boundary, and have their
+		 * remaining time updated from the timer.
+		 *
 		 * Returns true on timeout, false otherwise.
 		 */
 		bool suspend(Timeout     *t,
@@ -164,17 +175,34 @@ namespace
 		             bool         yieldUnconditionally = false,
 		             bool         yieldNotSleep        = false)
 		{
-			if (t->remaining != 0)
+			uint32_t remainingCycles = t->remainingCycles;
+			bool     isPrecise       = remainingCycles != 0;
+			bool     mayBlock        = isPrecise || (t->remaining != 0);
+			uint64_t start           = isPrecise ? TimerCore::time() : 0;
+			if (mayBlock)
 			{
-				suspend(t->remaining, newSleepQueue, yieldNotSleep);
+				suspend(isPrecise ? start + remainingCycles
+				                  : expiry_time_for_timeout(t->remaining),
+				        newSleepQueue,
+				        yieldNotSleep);
 			}
-			if ((t->remaining != 0) || yieldUnconditionally)
+			if (mayBlock || yieldUnconditionally)
 			{
 				auto elapsed = yield_timed();
 				if (CHERI::Capability{t}.is_valid())
 				{
 					t->elapse(elapsed);
-					if (t->remaining > 0)
+					if (isPrecise)
+					{
+						uint64_t elapsedCycles = TimerCore::time() - start;
+						t->remainingCycles =
+						  (elapsedCycles >= remainingCycles)
+						    ? 0
+						    : remainingCycles - elapsedCycles;
+						t->remaining =
+						  Timeout::ticks_for_timer_cycles(t->remainingCycles);
+					}
+					if (t->may_block())
 					{
 						return false;
 					}
@@ -207,11 +235,11 @@ namespace
 			static_assert(NPrios <
 			              std::numeric_limits<decltype(priority)>::max());
 			// All threads are created in blocked state.
-			timer_list_insert(&waitingList);
+			timer_heap_insert();
 		}
 
 		/**
-		 * Ready this thread. Remove self from the timer list, and optionally,
+		 * Ready this thread. Remove self from the timer heap, and optionally,
 		 * the list of the resource that this thread was blocked on. If thread
 		 * is readied not by the resource it was blocked on but by a timeout or
 		 * the resource disappearing, do some clean-ups.
@@ -225,8 +253,8 @@ namespace
 			Debug::Assert(state == ThreadState::Suspended,
 			              "Waking thread that is in state {}, not suspended",
 			              static_cast<ThreadState>(state));
-			// First, remove self from the timer waiting list.
-			timer_list_remove(&waitingList);
+			// First, remove self from the timer heap.
+			timer_heap_remove();
 			if (sleepQueue != nullptr)
 			{
 				// We were on a list waiting for some resource. Remove ourselves
@@ -286,9 +314,10 @@ namespace
 		/**
 		 * Suspend this thread. Take it off the ready list. If it is suspended
 		 * waiting on a resource, add it to the list of that resource. No
-		 * matter what, it has to be added to the timer list.
+		 * matter what, it has to be added to the timer heap, to be woken when
+		 * the timer reaches `expiry`.
 		 */
-		void suspend(uint32_t     waitTicks,
+		void suspend(uint64_t     expiry,
 		             ThreadImpl **newSleepQueue,
 		             bool         yieldNotSleep = false)
 		{
@@ -304,9 +333,9 @@ namespace
 				list_insert(newSleepQueue);
 				sleepQueue = newSleepQueue;
 			}
-			expiryTime = expiry_time_for_timeout(waitTicks);
+			expiryTime = expiry;
 
-			timer_list_insert(&waitingList);
+			timer_heap_insert();
 		}
 
 		/**
@@ -412,44 +441,21 @@ namespace
 			}
 		}
 
-		/// Same as list_insert(), but sorted on ExpiryTime.
-		void timer_list_insert(ThreadImpl **headPtr)
+		/**
+		 * Insert self into the timer heap.  The heap is ordered by expiry
+		 * time, so this costs O(log n) in the number of suspended threads.
+		 */
+		void timer_heap_insert()
 		{
-			ThreadImpl *head = *headPtr;
-
 			Debug::Assert(state == ThreadState::Suspended,
-			              "Inserting thread into timer list that is in state "
+			              "Inserting thread into timer heap that is in state "
 			              "{}, not suspended",
 			              static_cast<ThreadState>(state));
-			if (head == nullptr)
-			{
-				timerNext = timerPrev = *headPtr = this;
-			}
-			else
-			{
-				ThreadImpl *iter = head->timerPrev;
-				ThreadImpl *iterNext;
-
-				// Go back from tail, and stop at the first Thread whose expiry
-				// <= ours.
-				while (iter->expiryTime > expiryTime)
-				{
-					iter = iter->timerPrev;
-					if (iter == head->timerPrev)
-					{
-						break;
-					}
-				}
-				iterNext        = iter->timerNext;
-				iter->timerNext = iterNext->timerPrev = this;
-				timerNext                             = iterNext;
-				timerPrev                             = iter;
-
-				if (expiryTime < head->expiryTime)
-				{
-					*headPtr = this;
-				}
-			}
+			Debug::Assert(timerHeapSize < CONFIG_THREADS_NUM,
+			              "Timer heap overflow inserting thread {}",
+			              threadId);
+			timer_heap_set(timerHeapSize++, this);
+			timer_heap_sift_up(timerHeapIndex);
 		}
 
 		/// Remove self from the list headPtr points to.
@@ -483,35 +489,23 @@ namespace
 			next = prev = nullptr;
 		}
 
-		/// Same as list_remove(), but for the timer list.
-		void timer_list_remove(ThreadImpl **headPtr)
+		/// Remove self from the timer heap.
+		void timer_heap_remove()
 		{
-			ThreadImpl *head = *headPtr;
-
-			if (timerNext == this)
+			Debug::Assert(timerHeap[timerHeapIndex] == this,
+			              "Thread {} is not at its position in the timer heap",
+			              threadId);
+			ThreadImpl *last = timerHeap[--timerHeapSize];
+			if (last != this)
 			{
-				// We are the only one left on this list, clear the head.
-				Debug::Assert(timerPrev == this,
-				              "Invalid loop in thread list.  Next pointer "
-				              "points to this ({}) but previous pointer is {}",
-				              this,
-				              timerPrev);
-				*headPtr = nullptr;
+				// Move the last thread into the hole that we leave.  It may
+				// need to move either up or down from there, but at most one
+				// of these will move it.
+				uint16_t index = timerHeapIndex;
+				timer_heap_set(index, last);
+				timer_heap_sift_up(index);
+				timer_heap_sift_down(last->timerHeapIndex);
 			}
-			else
-			{
-				ThreadImpl *prevThread = timerPrev;
-				ThreadImpl *nextThread = timerNext;
-
-				prevThread->timerNext = nextThread;
-				nextThread->timerPrev = prevThread;
-
-				if (head == this)
-				{
-					*headPtr = timerNext;
-				}
-			}
-			timerNext = timerPrev = nullptr;
 		}
 
 		uint16_t id_get()
@@ -571,12 +565,6 @@ namespace
 		ThreadImpl *prev;
 		ThreadImpl *next;
 		///@}
-		/// Linked list fields to the global timer list, when this thread is
-		/// blocked with a timeout.
-		///@{
-		ThreadImpl *timerPrev;
-		ThreadImpl *timerNext;
-		///@}
 		/// Pointer to the list of the resource this thread is blocked on.
 		ThreadImpl **sleepQueue;
 		/**
@@ -626,6 +614,14 @@ namespace
 		 */
 		CHERI_SEALED(TrustedStack *) tStackPtr;
 
+		/**
+		 * Bitmap of the futex waiting lists that may contain threads that are
+		 * priority boosting this thread.  Bits are set when a thread starts
+		 * boosting this one and cleared lazily when recalculating the boost
+		 * finds no boosting threads in the corresponding list.
+		 */
+		uint16_t futexBoostingBuckets{0};
+
 		private:
 		/**
 		 * Helper to remove a thread from the priority map and update the
@@ -653,6 +649,75 @@ namespace
 			}
 		}
 
+		/**
+		 * Place `thread` at `index` in the timer heap.
+		 */
+		static void timer_heap_set(uint16_t index, ThreadImpl *thread)
+		{
+			timerHeap[index]       = thread;
+			thread->timerHeapIndex = index;
+		}
+
+		/**
+		 * Move the thread at `index` in the timer heap towards the root until
+		 * its parent does not expire later than it.
+		 */
+		static void timer_heap_sift_up(uint16_t index)
+		{
+			ThreadImpl *thread = timerHeap[index];
+			while (index > 0)
+			{
+				uint16_t parent = (index - 1) / 2;
+				if (timerHeap[parent]->expiryTime <= thread->expiryTime)
+				{
+					break;
+				}
+				timer_heap_set(index, timerHeap[parent]);
+				index = parent;
+			}
+			timer_heap_set(index, thread);
+		}
+
+		/**
+		 * Move the thread at `index` in the timer heap towards the leaves
+		 * until neither of its children expires earlier than it.
+		 */
+		static void timer_heap_sift_down(uint16_t index)
+		{
+			ThreadImpl *thread = timerHeap[index];
+			while (true)
+			{
+				uint16_t child = 2 * index + 1;
+				if (child >= timerHeapSize)
+				{
+					break;
+				}
+				if ((child + 1 < timerHeapSize) &&
+				    (timerHeap[child + 1]->expiryTime <
+				     timerHeap[child]->expiryTime))
+				{
+					child++;
+				}
+				if (thread->expiryTime <= timerHeap[child]->expiryTime)
+				{
+					break;
+				}
+				timer_heap_set(index, timerHeap[child]);
+				index = child;
+			}
+			timer_heap_set(index, thread);
+		}
+
+		/**
+		 * Binary min-heap of all suspended threads, ordered by expiry time.
+		 * All threads that are suspended must be in this heap.  Threads that
+		 * are blocked without a timeout have the maximum expiry time and so
+		 * sink to the leaves.
+		 */
+		static inline ThreadImpl *timerHeap[CONFIG_THREADS_NUM];
+		/// The number of threads in `timerHeap`.
+		static inline uint16_t timerHeapSize;
+
 		/// the current runnning thread
 		static inline ThreadImpl *current;
 		/// NPrios number of lists, each linking the threads of this priority
@@ -664,6 +729,8 @@ namespace
 		static inline uint16_t highestPriority;
 
 		uint16_t threadId;
+		/// This thread's position in `timerHeap`, if it is suspended.
+		uint16_t timerHeapIndex;
 		/**
 		 * The current priority level for this thread.  This may be influenced
 		 * by priority inheritance.
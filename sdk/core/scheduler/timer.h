@@ -34,7 +34,6 @@ namespace
 	class Timer final : private TimerCore
 	{
 		inline static uint64_t lastTickTime         = 0;
-		inline static uint64_t zeroTickTime         = 0;
 		inline static uint32_t accumulatedTickError = 0;
 
 		public:
@@ -47,7 +46,7 @@ namespace
 			              "Cycles per tick can't be represented in 32 bits. "
 			              "Double check your platform config");
 			init();
-			zeroTickTime = time();
+			lastTickTime = time();
 		}
 
 		/**
@@ -81,8 +80,9 @@ namespace
 		static void update()
 		{
 			auto *thread             = Thread::current_get();
-			bool  waitingListIsEmpty = ((Thread::waitingList == nullptr) ||
-                                       (Thread::waitingList->expiryTime == -1));
+			auto *earliest           = Thread::timer_heap_top();
+			bool  waitingListIsEmpty = ((earliest == nullptr) ||
+			                           (earliest->expiryTime == -1));
 			bool  threadHasNoPeers =
 			  (thread == nullptr) || (!thread->has_priority_peers());
 			if (waitingListIsEmpty && threadHasNoPeers)
@@ -98,7 +98,7 @@ namespace
 				                       : time() + TIMERCYCLES_PER_TICK;
 				uint64_t nextTimer = waitingListIsEmpty
 				                       ? DistantFuture
-				                       : Thread::waitingList->expiryTime;
+				                       : earliest->expiryTime;
 				setnext(std::min(nextTick, nextTimer));
 			}
 		}
@@ -118,43 +118,46 @@ namespace
 			}
 		}
 
+		/**
+		 * Bring the number of ticks since boot up to date with the current
+		 * time.  The timer is not programmed to fire on every tick, so this
+		 * must be called on every entry to the scheduler, not just on timer
+		 * interrupts.  The division is needed only when at least one tick
+		 * boundary has passed since the last update.
+		 */
+		static void update_ticks()
+		{
+			uint64_t elapsed = time() - lastTickTime;
+			if (elapsed >= TIMERCYCLES_PER_TICK)
+			{
+				uint64_t ticks = elapsed / TIMERCYCLES_PER_TICK;
+				Thread::ticksSinceBoot += ticks;
+				lastTickTime += ticks * TIMERCYCLES_PER_TICK;
+			}
+		}
+
 		/**
 		 * Wake any threads that were sleeping until a timeout before the
-		 * current time.  This also wakes yielded threads if there are no
-		 * runnable threads.
+		 * current time.  Unless the scheduler is built for tickless idle,
+		 * this also wakes yielded threads if there are no runnable threads.
 		 *
 		 * This should be called when a timer interrupt fires.
 		 */
 		static void expiretimers()
 		{
 			uint64_t now = time();
-			Thread::ticksSinceBoot =
-			  (now - zeroTickTime) / TIMERCYCLES_PER_TICK;
-			if (Thread::waitingList == nullptr)
-			{
-				return;
-			}
-			for (Thread *iter = Thread::waitingList;;)
+			// Each thread that is woken is removed from the heap, exposing the
+			// next-earliest expiry time at the top.
+			for (Thread *earliest;
+			     ((earliest = Thread::timer_heap_top()) != nullptr) &&
+			     (earliest->expiryTime <= now);)
 			{
-				if (iter->expiryTime <= now)
-				{
-					Thread *iterNext = iter->timerNext;
-
-					iter->ready(Thread::WakeReason::Timer);
-					iter = iterNext;
-					if (Thread::waitingList == nullptr ||
-					    iter == Thread::waitingList)
-					{
-						break;
-					}
-				}
-				else
-				{
-					break;
-				}
+				earliest->ready(Thread::WakeReason::Timer);
 			}
-			// If there are not runnable threads, try to wake a yielded thread
-			if (!Thread::any_ready())
+			// If there are not runnable threads, try to wake a yielded thread.
+			// In tickless mode, yielding threads sleep until their timeout so
+			// that the system can stay idle.
+			if (!Tickless && !Thread::any_ready())
 			{
 				// Look at the first thread.  If it is not yielding, there may
 				// be another thread behind it that is, but that's fine.  We
@@ -166,7 +169,7 @@ namespace
 				//    with a 1-tick timeout.
 				// 3. A wakes up and prevents B from running even though we're
 				//    still in its 5-tick yield period.
-				if (Thread *head = Thread::waitingList)
+				if (Thread *head = Thread::timer_heap_top())
 				{
 					if (head->is_yielding())
 					{
@@ -187,6 +190,8 @@ namespace
 		{
 			return -1;
 		}
-		return Timer::time() + (timeout * TIMERCYCLES_PER_TICK);
+		// Long timeouts can exceed 32 bits when converted to timer cycles.
+		return Timer::time() +
+		       (static_cast<uint64_t>(timeout) * TIMERCYCLES_PER_TICK);
 	}
 } // namespace
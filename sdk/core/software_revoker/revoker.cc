@@ -14,11 +14,13 @@ using CHERI::Permission;
  * We need an array of the allocations that provide the globals at the
  * start of our PCC, but the compiler doesn't currently provide a good way of
  * doing this, so do it with an assembly stub for loading the capabilities.
+ * The loader fills in one capability for each range of memory that can hold
+ * capabilities and leaves the remaining entries null.
  */
 __asm__("	.section .text, \"ax\", @progbits\n"
         "	.p2align 3\n"
         "globals:\n"
-        "	.zero 1*8\n"
+        "	.zero " __XSTRING(SOFTWARE_REVOKER_MAX_SCAN_RANGES) "*8\n"
         "	.globl get_globals\n"
         "get_globals:\n"
         "	sll        a0, a0, 3\n"
@@ -34,7 +36,8 @@ extern "C" volatile void *volatile *get_globals(int idx);
 namespace
 {
 	/**
-	 * The index of the current range to scan.  Must be 0 or -1.
+	 * The index of the current range to scan, or -1 if the revoker is not
+	 * running.
 	 */
 	int currentRange;
 	/**
@@ -76,18 +79,51 @@ namespace
 			case State::NotRunning:
 				return {0, State::Scanning};
 			case State::Scanning:
+				if (currentRange + 1 < SOFTWARE_REVOKER_MAX_SCAN_RANGES)
+				{
+					return {currentRange + 1, State::Scanning};
+				}
 				return {-1, State::NotRunning};
 		}
 	}
 
+#ifndef SOFTWARE_REVOKER_TICK_CYCLES
+#	define SOFTWARE_REVOKER_TICK_CYCLES 16384
+#endif
+
+	/**
+	 * The number of cycles that each tick may spend scanning.  Ticks run with
+	 * interrupts disabled, so this bounds the interrupt latency that the
+	 * revoker adds.  Invoking the revoker costs around 400 cycles on Flute, so
+	 * values much below a few thousand cycles spend most of the time on
+	 * domain transitions.  This is set with the
+	 * `software-revoker-tick-cycles` build option.  If it is zero, each tick
+	 * instead scans a fixed `TickSize` capabilities, however long that takes.
+	 */
+	static constexpr uint32_t TickCycles = SOFTWARE_REVOKER_TICK_CYCLES;
+
 	/**
-	 * The number of capabilities to scan per tick.  This probably needs some
-	 * tuning.  Invoking the revoker costs around 400 cycles on Flute, so we're
-	 * likely to be spending about half of our total time on domain transitions
-	 * with a value <100.
+	 * The number of capabilities to scan per tick if `TickCycles` is zero.
 	 */
 	static constexpr size_t TickSize = 4096;
 
+	/**
+	 * The number of capabilities to scan between reads of the cycle counter.
+	 * This is the granularity with which a tick is able to respect
+	 * `TickCycles`.
+	 */
+	static constexpr size_t BatchSize = 64;
+
+	/**
+	 * Read the low 32 bits of the cycle counter.
+	 */
+	__always_inline uint32_t cycles()
+	{
+		uint32_t cycles;
+		__asm__ volatile("csrr %0, mcycle" : "=r"(cycles));
+		return cycles;
+	}
+
 	/**
 	 * Advance the state machine to the next state.
 	 */
@@ -105,10 +141,13 @@ namespace
 		currentRange                = nextRange;
 		offset                      = 0;
 		// If we have a new range, set the length to something sensible.
+		// Unused entries are null and so are skipped with a zero length.
 		if (nextRange != -1)
 		{
-			length = __builtin_cheri_length_get(get_globals(currentRange)) /
-			         sizeof(void *);
+			auto range = get_globals(currentRange);
+			length     = __builtin_cheri_tag_get(range)
+			               ? __builtin_cheri_length_get(range) / sizeof(void *)
+			               : 0;
 		}
 		state = nextState;
 		// If we've finished a run, increment the epoch counter (it should now
@@ -121,26 +160,44 @@ namespace
 	}
 
 	/**
-	 * Scan a fixed-size range of the current memory region.
+	 * Scan `count` capabilities, starting at `offset`, in the current memory
+	 * region.
 	 */
-	void scan_range()
+	__always_inline void scan_words(size_t count)
 	{
-		size_t end     = offset + std::min(length - offset, TickSize);
+		size_t end     = offset + std::min(length - offset, count);
 		auto   current = get_globals(currentRange);
 		// With interrupts disabled, loading and storing a capability will
 		// clear the tag on anything that has been revoked via the load
 		// barrier.
-		for (int i = offset; i < end; i++)
+		for (size_t i = offset; i < end; i++)
 		{
 			current[i] = current[i];
 		}
 		// Record the amount that we've scanned.
 		offset = end;
-		// Advance to the next state if we've finished scanning this range.
-		if (offset == length)
+	}
+
+	/**
+	 * Scan memory until either this tick's budget is spent or the revocation
+	 * pass is finished, moving on to the next range as each one is finished.
+	 */
+	void scan_range()
+	{
+		// Always make some progress, even if the budget is smaller than a
+		// single batch.
+		uint32_t start = cycles();
+		do
 		{
-			advance();
-		}
+			scan_words((TickCycles == 0) ? TickSize : BatchSize);
+			// Advance to the next state if we've finished scanning this
+			// range.
+			if (offset == length)
+			{
+				advance();
+			}
+		} while ((TickCycles != 0) && (state == State::Scanning) &&
+		         ((cycles() - start) < TickCycles));
 	}
 
 } // namespace
@@ -85,12 +85,15 @@ namespace Ibex
 			/**
 			 * These two symbols mark the region that needs revocation.  We
 			 * revoke capabilities everywhere from the start of compartment
-			 * globals to the end of the heap.
+			 * globals to the end of the last heap region.  This device can
+			 * sweep only a single range, so, unlike the software revoker, it
+			 * also sweeps any gaps between heap regions.  The build system
+			 * rejects boards that place devices in those gaps.
 			 */
-			extern char __revoker_scan_start, __export_mem_heap_end;
+			extern char __revoker_scan_start, __heap_regions_end;
 
 			auto  base   = LA_ABS(__revoker_scan_start);
-			auto  top    = LA_ABS(__export_mem_heap_end);
+			auto  top    = LA_ABS(__heap_regions_end);
 			auto &device = revoker_device();
 			device.base  = base;
 			device.top   = top;
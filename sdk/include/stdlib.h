@@ -209,6 +209,97 @@ void *__cheri_compartment("allocator")
                       size_t              size,
                       uint32_t flags      __if_cxx(= AllocateWaitAny));
 
+/**
+ * Non-standard allocation API.  Allocates `size` bytes of memory whose base
+ * is aligned to `alignment` bytes, for example for buffers that a device
+ * accesses with DMA.  `alignment` must be a power of two.  Alignments smaller
+ * than the allocator's minimum (eight bytes) are rounded up.  The allocation
+ * may be more strongly aligned if this is needed for its bounds to be
+ * precisely representable.
+ *
+ * The padding needed to find an aligned address is returned to the heap, so
+ * only the memory for the object itself (and its header) is counted against
+ * the quota.  The `flags` and `timeout` parameters and the return value
+ * behave as for `heap_allocate`.  Returns `nullptr` if `alignment` is not a
+ * power of two.
+ *
+ * Memory returned from this interface is guaranteed to be zeroed.
+ */
+void *__cheri_compartment("allocator")
+  heap_allocate_aligned(Timeout            *timeout,
+                        AllocatorCapability heapCapability,
+                        size_t              size,
+                        size_t              alignment,
+                        uint32_t flags      __if_cxx(= AllocateWaitAny));
+
+/**
+ * Non-standard allocation API.  Resizes the allocation `pointer`, which must
+ * have been returned by a previous allocation with `heapCapability` and must
+ * not be claimed or sealed, to `size` bytes.  Returns a pointer to the
+ * resized object, or `nullptr` on failure, in which case `pointer` is left
+ * unmodified.  As with `heap_allocate`, `-ENOTENOUGHSTACK` may be returned if
+ * the stack is insufficiently large to run the function.
+ *
+ * If the chunk that follows the object is free and large enough, the object is
+ * grown in place and the returned pointer has the same base as `pointer` and
+ * wider bounds.  Existing pointers to the object remain valid but can reach
+ * only the original part of it.  Otherwise (and always when shrinking) a new
+ * object is allocated, the contents are copied, and the old object is freed,
+ * which revokes all pointers to it.  In this case, both objects count against
+ * the quota until the copy is complete.
+ *
+ * The `timeout` is used only if a new object must be allocated.  Memory
+ * beyond the original size is guaranteed to be zeroed.
+ */
+void *__cheri_compartment("allocator")
+  heap_resize(Timeout            *timeout,
+              AllocatorCapability heapCapability,
+              void               *pointer,
+              size_t              size);
+
+/**
+ * Non-standard allocation API.  Allocates `count` separate objects of `size`
+ * bytes each, in a single call into the allocator, and stores pointers to them
+ * in `out`, which must have space for `count` pointers.  Each object is
+ * separately bounded and must be freed with its own call to `heap_free`.
+ * Blocking behaviour is controlled by `flags` and `timeout`, as for
+ * `heap_allocate`, and the timeout covers the whole batch.  The quota for the
+ * whole batch is reserved before any object is allocated, so a batch that
+ * waits for quota waits until all of it is available.
+ *
+ * Allocation is all-or-nothing.  Returns 0 on success.  On failure, returns
+ * `-EINVAL` if `count` is too large, `size` cannot be allocated, or `out` is
+ * not a valid array; `-EPERM` if `heapCapability` is not a valid allocator
+ * capability; or `-ENOMEM` if the objects could not all be allocated.  In all
+ * of these cases, `out` is not modified and no quota is consumed.
+ *
+ * Similarly to `heap_allocate`, `-ENOTENOUGHSTACK` may be returned if the
+ * stack is insufficiently large to run the function.
+ *
+ * Memory returned from this interface is guaranteed to be zeroed.
+ */
+int __cheri_compartment("allocator")
+  heap_allocate_batch(Timeout            *timeout,
+                      AllocatorCapability heapCapability,
+                      size_t              size,
+                      size_t              count,
+                      void              **out,
+                      uint32_t flags      __if_cxx(= AllocateWaitAny));
+
+/**
+ * Mixed-size variant of `heap_allocate_batch`.  Allocates `count` objects,
+ * where the object stored in `out[i]` is `sizes[i]` bytes long.  The return
+ * values and all-or-nothing semantics are the same as for
+ * `heap_allocate_batch`.
+ */
+int __cheri_compartment("allocator")
+  heap_allocate_batch_sizes(Timeout            *timeout,
+                            AllocatorCapability heapCapability,
+                            const size_t       *sizes,
+                            size_t              count,
+                            void              **out,
+                            uint32_t flags      __if_cxx(= AllocateWaitAny));
+
 /**
  * Add a claim to an allocation.  The object will be counted against the quota
  * provided by the first argument until a corresponding call to `heap_free`.
@@ -245,6 +336,24 @@ int __cheri_libcall heap_claim_ephemeral(Timeout         *timeout,
                                          const void      *ptr,
                                          const void *ptr2 __if_cxx(= nullptr));
 
+/**
+ * Claim up to `CHERIOT_HAZARD_SLOTS` pointers using the ephemeral claims
+ * mechanism.  This behaves like `heap_claim_ephemeral` for the `count`
+ * pointers in the `pointers` array and releases any ephemeral claims held in
+ * the remaining slots.
+ *
+ * In addition to the errors that `heap_claim_ephemeral` can return, this
+ * returns `-EINVAL` if `count` is larger than the number of hazard slots that
+ * each thread has.  The number of slots is configured at build time with the
+ * `hazard-slots` option.
+ *
+ * This function is provided by the `compartment_helpers` library, which must be
+ * linked for it to be available.
+ */
+int __cheri_libcall heap_claim_ephemeral_array(Timeout           *timeout,
+                                               const void *const *pointers,
+                                               size_t             count);
+
 __attribute__((deprecated("heap_claim_fast was a bad name.  This function has "
                           "been renamed heap_claim_ephemeral")))
 __always_inline static int
@@ -265,9 +374,37 @@ heap_claim_fast(Timeout         *timeout,
 int __cheri_compartment("allocator")
   heap_free(AllocatorCapability heapCapability, void *ptr);
 
+/**
+ * The maximum number of pointers that can be passed to a single call to
+ * `heap_free_batch`.  This is limited by the size of the return value.
+ */
+static const size_t HeapFreeBatchMax = 31;
+
+/**
+ * Free up to `HeapFreeBatchMax` heap allocations (or drop claims on them) in
+ * a single call into the allocator.  This is equivalent to calling
+ * `heap_free` on each non-null entry in `ptrs` but is cheaper when tearing
+ * down a structure made of many objects.  Null entries are ignored.
+ *
+ * Returns a bitmap with bit `i` set if `ptrs[i]` could not be freed, so zero
+ * indicates that every entry was freed.  Returns `-EPERM` if
+ * `heapCapability` is not a valid allocator capability, `-EINVAL` if `count`
+ * is larger than `HeapFreeBatchMax` or `ptrs` is not a valid array of `count`
+ * pointers (in which case nothing is freed), or `-ENOTENOUGHSTACK` if the
+ * stack size is insufficiently large to safely run the function.
+ */
+ssize_t __cheri_compartment("allocator")
+  heap_free_batch(AllocatorCapability heapCapability,
+                  void              **ptrs,
+                  size_t              count);
+
 /**
  * Free all allocations owned by this capability.
  *
+ * The allocator keeps an index of the objects owned by each capability, so
+ * the cost of this call is proportional to the number of objects that this
+ * capability owns or has claimed, not to the size of the heap.
+ *
  * Returns the number of bytes freed, `-EPERM` if this is not a valid heap
  * capability, or `-ENOTENOUGHSTACK` if the stack size is insufficiently large
  * to safely run the function.
@@ -275,6 +412,70 @@ int __cheri_compartment("allocator")
 ssize_t __cheri_compartment("allocator")
   heap_free_all(AllocatorCapability heapCapability);
 
+/**
+ * Type for handles to fixed-size object pools, created with
+ * `heap_pool_create`.
+ */
+typedef CHERI_SEALED(struct HeapPoolState *) HeapPool;
+
+/**
+ * Create a pool of `count` objects of `objectSize` bytes.  The pool is a
+ * single allocation, made against the quota of `heapCapability`, that holds
+ * the objects and the pool's bookkeeping.  The object size is rounded up so
+ * that each object can have precise bounds and the pool's size is therefore
+ * slightly larger than `objectSize * count`.
+ *
+ * Allocating and freeing pool objects takes constant time and does not
+ * touch the allocator's free lists.  Freed objects are still reused only
+ * after revocation has removed all capabilities to them.
+ *
+ * The pool is not freed by `heap_free_all`.  Individual pool objects cannot
+ * be claimed; claims made through a pointer to a pool object apply to the
+ * entire pool.
+ *
+ * Returns a sealed handle to the pool, or null on failure.
+ */
+HeapPool __cheri_compartment("allocator")
+  heap_pool_create(Timeout            *timeout,
+                   AllocatorCapability heapCapability,
+                   size_t              objectSize,
+                   size_t              count);
+
+/**
+ * Allocate a zeroed object from `pool`.  If every free object is still
+ * waiting for revocation, this waits for revocation for up to `timeout`.
+ *
+ * Returns a pointer to the object, or null if the pool is exhausted, if the
+ * timeout expired, or if `pool` is not a valid pool.  As with
+ * `heap_allocate`, callers must check the tag of the result rather than
+ * comparing it to null.
+ */
+void *__cheri_compartment("allocator")
+  heap_pool_allocate(Timeout *timeout, HeapPool pool);
+
+/**
+ * Return an object to `pool`.  `object` must be the pointer that
+ * `heap_pool_allocate` returned.
+ *
+ * Returns 0 on success, `-EPERM` if `pool` is not a valid pool, `-EINVAL` if
+ * `object` is not an allocated object in `pool`, `-EBUSY` if `object` is held
+ * by an ephemeral claim (see `heap_claim_ephemeral`) and so cannot be freed
+ * yet, or `-ENOTENOUGHSTACK` if the stack is too small.
+ */
+int __cheri_compartment("allocator")
+  heap_pool_free(HeapPool pool, void *object);
+
+/**
+ * Destroy `pool`, which must have been created with `heapCapability`.  This
+ * frees the pool's allocation, including any objects that are still
+ * allocated.
+ *
+ * Returns 0 on success or a negated errno value on failure, as for
+ * `heap_free`.
+ */
+int __cheri_compartment("allocator")
+  heap_pool_destroy(AllocatorCapability heapCapability, HeapPool pool);
+
 /**
  * Returns 0 if the allocation can be freed with the given capability, a
  * negated errno value otherwise.
@@ -330,6 +531,25 @@ static int heap_quarantine_empty(void)
 	return heap_quarantine_flush(&t);
 }
 
+/**
+ * Do allocator housekeeping work that would otherwise be done on the
+ * allocation path.  If the quarantine is empty, this first waits for objects
+ * to be freed.  It then moves objects out of quarantine as their revocation
+ * finishes, coalescing them into the free lists and clearing their revocation
+ * bits, and starts (or, with a synchronous revoker, performs) revocation when
+ * nothing in quarantine is ready.
+ *
+ * This is intended to be called in a loop from a thread at the lowest
+ * priority in the system, so that the work happens when the system is
+ * otherwise idle.  The work is done in small steps and the allocator lock is
+ * released between steps, so a higher-priority thread is delayed by at most
+ * one step.
+ *
+ * Returns 0 once the quarantine is empty, `-ETIMEDOUT` if the timeout
+ * expires first, or `-EINVAL` if the timeout is not valid.
+ */
+int __cheri_compartment("allocator") heap_housekeeping(Timeout *timeout);
+
 /**
  * Returns true if `object` points to a valid heap address, false otherwise.
  * Note that this does *not* check that this is a valid pointer.  This should
@@ -344,15 +564,99 @@ __if_c(static) inline _Bool heap_address_is_valid(const void *object)
 {
 	ptraddr_t heap_start = LA_ABS(__export_mem_heap);
 	ptraddr_t heap_end   = LA_ABS(__export_mem_heap_end);
-	// The heap allocator has the only capability to the heap region.  Any
-	// capability is either (transitively) derived from the heap capability or
+	// The heap allocator has the only capability to the heap regions.  Any
+	// capability is either (transitively) derived from a heap capability or
 	// derived from something else and so it is sufficient to check that the
 	// base is within the range of the heap.  Anything derived from a non-heap
-	// capability must have a base outside of that range.
+	// capability must have a base outside of that range.  Any additional heap
+	// regions are checked individually, because the gaps between them may
+	// contain other memory or devices.
 	ptraddr_t address = __builtin_cheri_base_get(object);
+#ifdef CHERIOT_HEAP_REGIONS
+#	define CHERIOT_HEAP_REGION(name, preferredMaxAllocation)                   \
+		|| ((address >= LA_ABS(__export_mem_##name)) &&                        \
+		    (address < LA_ABS(__export_mem_##name##_end)))
+	return ((address >= heap_start) && (address < heap_end))
+	  CHERIOT_HEAP_REGIONS;
+#	undef CHERIOT_HEAP_REGION
+#else
 	return (address >= heap_start) && (address < heap_end);
+#endif
 }
 
+/**
+ * Statistics about the heap, filled in by `heap_stats`.  Sizes are in bytes
+ * and include the eight-byte header on each chunk.
+ */
+struct HeapStats
+{
+	/// Memory that is free and can be allocated.
+	size_t freeBytes;
+	/// Memory that has been freed but is still in quarantine.
+	size_t quarantinedBytes;
+	/**
+	 * Memory in live allocations, including allocator metadata.  This does
+	 * not include `cachedBytes`.
+	 */
+	size_t inUseBytes;
+	/**
+	 * Memory held in the allocator's sealed-object cache for reuse by later
+	 * allocations.  This is not allocated to anyone and is not counted in
+	 * `freeBytes` either.
+	 */
+	size_t cachedBytes;
+	/// The size of the largest free chunk.
+	size_t largestFreeChunk;
+	/**
+	 * The number of free chunks in each of the allocator's small bins.  Small
+	 * bin `i` holds chunks of exactly `8 * i` bytes.
+	 */
+	uint16_t smallBinChunks[8];
+	/**
+	 * The number of free chunks in each of the allocator's tree bins.  Each
+	 * tree bin holds chunks in a range of sizes, with each bin covering half
+	 * of a power of two, starting at 64 bytes.
+	 */
+	uint16_t treeBinChunks[12];
+	/// The quota remaining in the allocator capability passed to `heap_stats`.
+	size_t quotaRemaining;
+	/**
+	 * The smallest quota that has remained in the allocator capability passed
+	 * to `heap_stats`.  The difference between this and the capability's
+	 * original quota is the peak amount of memory that it has had allocated.
+	 */
+	size_t quotaLowWater;
+	/**
+	 * The number of allocation attempts that could never succeed (for
+	 * example, because they were larger than the heap).
+	 */
+	uint32_t failuresPermanent;
+	/**
+	 * The number of allocation attempts that failed because the memory needed
+	 * was still in quarantine.
+	 */
+	uint32_t failuresRevocationNeeded;
+	/// The number of allocation attempts that failed for lack of quota.
+	uint32_t failuresQuotaExceeded;
+	/// The number of allocation attempts that failed for lack of free memory.
+	uint32_t failuresHeapFull;
+	/// The number of revocation passes that have completed.
+	uint32_t revocationEpochs;
+};
+
+/**
+ * Report statistics about the heap and about the quota of `heapCapability`
+ * into `stats`.  These are read from counters that the allocator maintains
+ * and so this does not walk the heap.  Allocation failures are counted for
+ * each attempt, so a blocking allocation that retries may be counted more
+ * than once.
+ *
+ * Returns 0 on success, `-EINVAL` if `stats` is not a valid pointer, or
+ * `-EPERM` if `heapCapability` is not a valid allocator capability.
+ */
+int __cheri_compartment("allocator")
+  heap_stats(AllocatorCapability heapCapability, struct HeapStats *stats);
+
 /**
  * Dump a textual rendering of the heap's structure to the debug console.
  *
@@ -362,6 +666,36 @@ __if_c(static) inline _Bool heap_address_is_valid(const void *object)
  */
 int __cheri_compartment("allocator") heap_render();
 
+/**
+ * Print the allocation trace recorded since the last call to the debug
+ * console.  Each allocation, free, claim, and `heap_free_all` call is recorded
+ * in a fixed-size ring buffer, so records are lost if the trace is not dumped
+ * often enough.  The output can be decoded, summarised, and turned into a
+ * replay workload with `scripts/allocator_trace.py`.
+ *
+ * If the RTOS is not built with --allocator-trace=y, this is a no-op.
+ *
+ * Returns zero on success, or `-ENOTENOUGHSTACK` if the stack is too small.
+ */
+int __cheri_compartment("allocator") heap_trace_dump();
+
+/**
+ * Print a snapshot of the heap to the debug console.  This lists the address,
+ * size, and state (free, in use, quarantined, or cached for reuse) of every
+ * chunk in every heap region, along with the identifier of the allocator
+ * capability that owns it and whether it is a sealed object.  The output can
+ * be turned into fragmentation maps and per-owner usage, and used to find the
+ * largest allocation that can succeed, with `scripts/heap_snapshot.py`.
+ *
+ * The allocator lock is held while the snapshot is printed, so other threads
+ * cannot allocate or free memory until it finishes.
+ *
+ * If the RTOS is not built with --allocator-snapshot=y, this is a no-op.
+ *
+ * Returns zero on success, or `-ENOTENOUGHSTACK` if the stack is too small.
+ */
+int __cheri_compartment("allocator") heap_snapshot_dump();
+
 static inline void __dead2 abort()
 {
 	panic();
@@ -430,3 +764,24 @@ unsigned long __cheri_libcall strtoul(const char *nptr,
                                       int         base);
 
 __END_DECLS
+
+#ifdef __cplusplus
+#	include <switcher.h>
+
+/**
+ * Variadic form of `heap_claim_ephemeral`, which claims more than two pointers
+ * at once.  The number of pointers must not exceed the number of hazard slots
+ * per thread (`CHERIOT_HAZARD_SLOTS`).
+ */
+template<typename... Pointers>
+    requires(sizeof...(Pointers) > 2)
+__always_inline static inline int
+heap_claim_ephemeral(Timeout *timeout, const Pointers *...pointers)
+{
+	static_assert(sizeof...(Pointers) <= CHERIOT_HAZARD_SLOTS,
+	              "Too many pointers for the configured number of hazard "
+	              "slots, see the hazard-slots build option");
+	const void *array[] = {static_cast<const void *>(pointers)...};
+	return heap_claim_ephemeral_array(timeout, array, sizeof...(Pointers));
+}
+#endif
@@ -3,6 +3,15 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#ifndef CHERIOT_HAZARD_SLOTS
+/**
+ * The number of hazard-pointer slots that each thread has.  This is set by
+ * the build system (`--hazard-slots=`) and must be the same in every
+ * component of a firmware image.
+ */
+#	define CHERIOT_HAZARD_SLOTS 2
+#endif
+
 /**
  * Returns true if the trusted stack contains at least `requiredFrames` frames
  * past the current one, false otherwise.
@@ -46,9 +55,10 @@ __cheri_libcall void *switcher_current_thread(void);
 __cheri_libcall _Bool switcher_interrupt_thread(void *);
 
 /**
- * Returns a store-only capability to two hazard pointer slots for the current
- * thread.  Objects stored here will not be deallocated until (at least) the
- * next cross-compartment call or until they are explicitly overwritten.
+ * Returns a store-only capability to the `CHERIOT_HAZARD_SLOTS` hazard
+ * pointer slots for the current thread.  Objects stored here will not be
+ * deallocated until (at least) the next cross-compartment call or until they
+ * are explicitly overwritten.
  */
 __cheri_libcall void **switcher_thread_hazard_slots(void);
 
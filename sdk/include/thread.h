@@ -63,6 +63,29 @@ enum ThreadSleepFlags : uint32_t
 [[cheriot::interrupt_state(disabled)]] int __cheri_compartment("scheduler")
   thread_sleep(struct Timeout *timeout, uint32_t flags __if_cxx(= 0));
 
+/**
+ * Returns the current value of the scheduler's timer, which counts at
+ * `CPU_TIMER_HZ`.  This is the time base used by `thread_sleep_until`.
+ */
+[[cheriot::interrupt_state(disabled)]] uint64_t __cheri_compartment(
+  "scheduler") thread_timer_get(void);
+
+/**
+ * Sleep until the scheduler's timer (see `thread_timer_get`) reaches
+ * `deadline`.
+ *
+ * Unlike `thread_sleep`, the wake time does not depend on when this is
+ * called, so a thread that repeatedly sleeps until deadlines a fixed period
+ * apart runs at a fixed rate, without drift from the time taken by its work
+ * or by preemption.  The thread is never woken early, but a higher-priority
+ * thread may prevent it from running at the deadline.
+ *
+ * Returns 0 after sleeping, or `-ETIMEDOUT` without sleeping if the deadline
+ * has already passed.
+ */
+[[cheriot::interrupt_state(disabled)]] int __cheri_compartment("scheduler")
+  thread_sleep_until(uint64_t deadline);
+
 /**
  * Return the thread ID of the current running thread.
  * This is mostly useful where one compartment can run under different threads
@@ -106,6 +129,18 @@ __cheri_compartment("scheduler") uint64_t thread_elapsed_cycles_current(void);
  */
 __cheri_compartment("scheduler") uint16_t thread_count();
 
+/**
+ * Returns the number of timer interrupts that the scheduler has handled since
+ * boot.
+ *
+ * The timer is programmed to fire only when a sleeping thread's timeout
+ * expires or when runnable threads of the same priority need to be
+ * time-sliced, so this is normally much lower than the number of ticks that
+ * have elapsed.
+ */
+[[cheriot::interrupt_state(disabled)]] __cheri_compartment(
+  "scheduler") uint64_t thread_timer_interrupt_count(void);
+
 /**
  * Wait for the specified number of microseconds.  This is a busy-wait loop,
  * not a yield.  If the thread is preempted then the wait will be longer than
@@ -215,4 +250,73 @@ __always_inline T *&invocation_state()
 	return *reinterpret_cast<T **>(invocation_state_slot(Index));
 }
 
+/**
+ * Helper for periodic threads.  Each call to `wait` sleeps until the start of
+ * the next period.  Periods start at exact multiples of the period after
+ * construction, independent of how long the work in each period takes.
+ *
+ * If the work in a period overruns, the periods that have already started are
+ * skipped rather than run back to back, so the thread stays in phase.  The
+ * number of skipped periods is returned from `wait`.
+ */
+class PeriodicTimer
+{
+	/// The length of each period, in timer cycles.
+	uint64_t period;
+
+	/// The timer value at which the next period starts.
+	uint64_t nextRelease;
+
+	public:
+	/**
+	 * Constructor.  The first period starts one `period` (in cycles of the
+	 * scheduler's timer) from now.  A period of zero is clamped to one cycle.
+	 */
+	PeriodicTimer(uint64_t period)
+	  : period(period > 0 ? period : 1),
+	    nextRelease(thread_timer_get() + this->period)
+	{
+	}
+
+	/**
+	 * Returns a periodic timer whose period is the nearest number of timer
+	 * cycles to `microseconds`, or one cycle if that would be zero.
+	 */
+	static PeriodicTimer from_microseconds(uint32_t microseconds)
+	{
+		return {(static_cast<uint64_t>(microseconds) * CPU_TIMER_HZ + 500000) /
+		        1000000};
+	}
+
+	/**
+	 * Returns the timer value at which the next period starts.
+	 */
+	uint64_t next_release()
+	{
+		return nextRelease;
+	}
+
+	/**
+	 * Sleep until the start of the next period.  Returns the number of
+	 * periods that had already started and have been skipped, or 0 if the
+	 * work in the last period finished on time.
+	 */
+	uint32_t wait()
+	{
+		uint32_t overruns = 0;
+		uint64_t now      = thread_timer_get();
+		if (now >= nextRelease)
+		{
+			uint64_t missed = (now - nextRelease) / period + 1;
+			overruns        = missed > UINT32_MAX ? UINT32_MAX : missed;
+			nextRelease += missed * period;
+		}
+		// This can fail only if the next period has started since we read
+		// the timer, in which case it is already time to run.
+		(void)thread_sleep_until(nextRelease);
+		nextRelease += period;
+		return overruns;
+	}
+};
+
 #endif
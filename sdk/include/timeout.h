@@ -10,6 +10,9 @@
 
 #include <cdefs.h>
 #include <stdint.h>
+#ifdef __cplusplus
+#	include <tick_macros.h>
+#endif
 
 /**
  * Quantity used for measuring time for timeouts.  The unit is scheduler ticks.
@@ -43,6 +46,18 @@ typedef struct Timeout
 	 * timeout.
 	 */
 	Ticks remaining;
+	/**
+	 * If non-zero, this is a precise timeout and this is the remaining time
+	 * in cycles of the scheduler's timer (`CPU_TIMER_HZ`).  A thread that
+	 * blocks with a precise timeout is woken when exactly this many timer
+	 * cycles have elapsed, rather than at a tick boundary.  The scheduler
+	 * decrements this by the exact time spent blocked and sets `remaining`
+	 * to the number of ticks that this rounds up to.
+	 *
+	 * C code may set this field directly, C++ code should use the
+	 * `from_timer_cycles` or `from_microseconds` factory methods.
+	 */
+	uint32_t remainingCycles __if_cxx(= 0);
 #ifdef __cplusplus
 	/**
 	 * Constructor, initialises this structure to allow `time` ticks to
@@ -60,9 +75,44 @@ typedef struct Timeout
 	{
 	}
 
+	/**
+	 * Returns a precise timeout that allows `cycles` cycles of the
+	 * scheduler's timer to elapse.
+	 */
+	static Timeout from_timer_cycles(uint32_t cycles)
+	{
+		Timeout t{ticks_for_timer_cycles(cycles)};
+		t.remainingCycles = cycles;
+		return t;
+	}
+
+	/**
+	 * Returns a precise timeout that allows at least `microseconds` to
+	 * elapse.  The resolution is one cycle of the scheduler's timer.
+	 */
+	static Timeout from_microseconds(uint32_t microseconds)
+	{
+		uint64_t cycles =
+		  (static_cast<uint64_t>(microseconds) * CPU_TIMER_HZ + 999999) /
+		  1000000;
+		return from_timer_cycles(
+		  cycles > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(cycles));
+	}
+
+	/**
+	 * Returns the number of ticks needed for `cycles` cycles of the
+	 * scheduler's timer to elapse, rounded up.
+	 */
+	static Ticks ticks_for_timer_cycles(uint32_t cycles)
+	{
+		return (static_cast<uint64_t>(cycles) + TIMERCYCLES_PER_TICK - 1) /
+		       TIMERCYCLES_PER_TICK;
+	}
+
 	/**
 	 * Update this timeout if `time` ticks have elapsed.  This function
-	 * saturates the values on overflow.
+	 * saturates the values on overflow.  The remaining time of a precise
+	 * timeout is reduced by the length of `time` ticks.
 	 */
 	inline void elapse(Ticks time)
 	{
@@ -75,6 +125,13 @@ typedef struct Timeout
 		{
 			remaining = 0;
 		}
+		if (remainingCycles != 0)
+		{
+			uint64_t cycles =
+			  static_cast<uint64_t>(time) * TIMERCYCLES_PER_TICK;
+			remainingCycles =
+			  (cycles >= remainingCycles) ? 0 : remainingCycles - cycles;
+		}
 	}
 
 	/**
@@ -82,7 +139,7 @@ typedef struct Timeout
 	 */
 	bool may_block()
 	{
-		return remaining > 0;
+		return (remaining > 0) || (remainingCycles > 0);
 	}
 #endif
 } Timeout;
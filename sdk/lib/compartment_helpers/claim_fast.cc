@@ -7,32 +7,52 @@
 #include <stdlib.h>
 #include <switcher.h>
 
-int heap_claim_ephemeral(Timeout *timeout, const void *ptr, const void *ptr2)
+int heap_claim_ephemeral_array(Timeout           *timeout,
+                               const void *const *pointers,
+                               size_t             count)
 {
+	if (count > CHERIOT_HAZARD_SLOTS)
+	{
+		return -EINVAL;
+	}
 	void   **hazards = switcher_thread_hazard_slots();
 	auto    *epochCounter{const_cast<
 	     cheriot::atomic<uint32_t> *>(SHARED_OBJECT_WITH_PERMISSIONS(
       cheriot::atomic<uint32_t>, allocator_epoch, true, false, false, false))};
-	uint32_t epoch  = epochCounter->load();
-	int      values = 2;
-	// Skip processing pointers that don't refer to heap memory.
-	if (!heap_address_is_valid(ptr))
+	uint32_t epoch = epochCounter->load();
+	// Copy the pointers so that the caller cannot change them between the
+	// hazard slots being written and the pointers being checked.  Skip
+	// processing pointers that don't refer to heap memory and pad the unused
+	// slots with null, so that any previous ephemeral claims are dropped.
+	const void *ptrs[CHERIOT_HAZARD_SLOTS];
+	size_t      values = 0;
+	for (size_t i = 0; i < CHERIOT_HAZARD_SLOTS; i++)
 	{
-		ptr = nullptr;
-		values--;
-	}
-	if (!heap_address_is_valid(ptr2))
-	{
-		ptr2 = nullptr;
-		values--;
+		ptrs[i] = nullptr;
+		if ((i < count) && heap_address_is_valid(pointers[i]))
+		{
+			ptrs[i] = pointers[i];
+			values++;
+		}
 	}
-	// If neither pointer refers to heap memory, set without synchronizing.  It
+	auto setHazards = [&]() {
+		for (size_t i = 0; i < CHERIOT_HAZARD_SLOTS; i++)
+		{
+			hazards[i] = const_cast<void *>(ptrs[i]);
+		}
+	};
+	auto clearHazards = [&]() {
+		for (size_t i = 0; i < CHERIOT_HAZARD_SLOTS; i++)
+		{
+			hazards[i] = nullptr;
+		}
+	};
+	// If no pointer refers to heap memory, set without synchronizing.  It
 	// doesn't matter if the revoker sees these or not, they cannot extend the
 	// lifetime of a heap object.
 	if (values == 0)
 	{
-		hazards[0] = nullptr;
-		hazards[1] = nullptr;
+		clearHazards();
 		return 0;
 	}
 	uint32_t oldEpoch;
@@ -56,19 +76,24 @@ int heap_claim_ephemeral(Timeout *timeout, const void *ptr, const void *ptr2)
 			}
 			epoch = epochCounter->load();
 		}
-		hazards[0] = const_cast<void *>(ptr);
-		hazards[1] = const_cast<void *>(ptr2);
-		oldEpoch   = epoch;
-		epoch      = epochCounter->load();
+		setHazards();
+		oldEpoch = epoch;
+		epoch    = epochCounter->load();
 	} while (epoch != oldEpoch);
-	auto isValidOrNull = [](CHERI::Capability<const void> pointer) {
-		return pointer.is_valid() || (pointer == nullptr);
-	};
-	if (isValidOrNull(ptr) && isValidOrNull(ptr2))
+	for (size_t i = 0; i < CHERIOT_HAZARD_SLOTS; i++)
 	{
-		return 0;
+		CHERI::Capability<const void> pointer{ptrs[i]};
+		if (!pointer.is_valid() && (pointer != nullptr))
+		{
+			clearHazards();
+			return -EINVAL;
+		}
 	}
-	hazards[0] = nullptr;
-	hazards[1] = nullptr;
-	return -EINVAL;
+	return 0;
+}
+
+int heap_claim_ephemeral(Timeout *timeout, const void *ptr, const void *ptr2)
+{
+	const void *pointers[] = {ptr, ptr2};
+	return heap_claim_ephemeral_array(timeout, pointers, 2);
 }
@@ -30,17 +30,58 @@ option("scheduler-accounting")
 	set_description("Track per-thread cycle counts in the scheduler");
 	set_showmenu(true)
 
+option("scheduler-tickless")
+	set_default(false)
+	set_description("Leave the system idle until the next timeout instead of waking yielding threads early when no other thread is runnable");
+	set_showmenu(true)
+
 option("scheduler-multiwaiter")
 	set_default(true)
 	set_description("Enable multiwaiter support in the scheduler.  Disabling this can reduce code size if multiwaiters are not used.");
 	set_showmenu(true)
 
 
+option("hazard-slots")
+	set_default("2")
+	set_description("Number of hazard-pointer slots per thread for ephemeral claims (2-8)")
+	set_showmenu(true)
+
 option("allocator-rendering")
 	set_default(false)
 	set_description("Include heap_render() functionality in the allocator")
 	set_showmenu(true)
 
+option("allocator-slab")
+	set_default(false)
+	set_description("Serve small (up to 128-byte) allocations from per-size-class slab caches in the allocator")
+	set_showmenu(true)
+
+option("allocator-sealed-cache")
+	set_default(true)
+	set_description("Keep recently destroyed sealed objects for reuse by the next allocation with the same sealing key")
+	set_showmenu(true)
+
+option("allocator-quarantine-drain")
+	set_default("adaptive")
+	set_description("Policy for how many chunks each allocation and free moves out of the allocator's quarantine")
+	set_values("fixed", "adaptive")
+	set_showmenu(true)
+
+option("allocator-trace")
+	set_default(false)
+	set_description("Record allocator operations in a ring buffer that heap_trace_dump() prints")
+	set_showmenu(true)
+
+option("allocator-snapshot")
+	set_default(false)
+	set_description("Include heap_snapshot_dump(), which prints every heap chunk in a machine-readable form")
+	set_showmenu(true)
+
+option("software-revoker-tick-cycles")
+	set_default("16384")
+	set_description("Cycles that each step of the software revoker may spend with interrupts disabled (0 scans a fixed amount per step)")
+	set_showmenu(true)
+
 function debugOption(name)
 	option("debug-" .. name)
 		set_default(false)
@@ -281,6 +322,11 @@ target("cheriot.allocator")
 		target:set("cheriot.compartment", "allocator")
 		target:set('cheriot.debug-name', "allocator")
 		target:add('defines', "HEAP_RENDER=" .. tostring(get_config("allocator-rendering")))
+		target:add('defines', "ALLOCATOR_SLAB=" .. tostring(get_config("allocator-slab")))
+		target:add('defines', "ALLOCATOR_SEALED_CACHE=" .. tostring(get_config("allocator-sealed-cache")))
+		target:add('defines', "ALLOCATOR_ADAPTIVE_DRAIN=" .. tostring(get_config("allocator-quarantine-drain") == "adaptive"))
+		target:add('defines', "ALLOCATOR_TRACE=" .. tostring(get_config("allocator-trace")))
+		target:add('defines', "ALLOCATOR_SNAPSHOT=" .. tostring(get_config("allocator-snapshot")))
 	end)
 
 target("cheriot.token_library")
@@ -298,6 +344,11 @@ target("cheriot.software_revoker")
 		target:set("cheriot.compartment", "software_revoker")
 		target:set("cheriot.ldscript", "software_revoker.ldscript")
 		target:add("defines", "CHERIOT_NO_AMBIENT_MALLOC")
+		local tick_cycles = tonumber(get_config("software-revoker-tick-cycles"))
+		if (tick_cycles == nil) or (tick_cycles < 0) or (tick_cycles ~= math.floor(tick_cycles)) then
+			raise("software-revoker-tick-cycles must be a non-negative integer, not " .. tostring(get_config("software-revoker-tick-cycles")))
+		end
+		target:add("defines", "SOFTWARE_REVOKER_TICK_CYCLES=" .. tick_cycles)
 	end)
 
 -- Helper to find a board file given either the name of a board file or a path.
@@ -645,6 +696,16 @@ rule("cheriot.firmware")
 			add_defines_each_dependency("SIMULATION")
 		end
 
+		-- Every thread has this many hazard-pointer slots.  The switcher
+		-- clears them, the loader allocates them, and the allocator and the
+		-- ephemeral-claim helpers use them, so they must all agree.
+		local hazard_slots = tonumber(get_config("hazard-slots"))
+		if (hazard_slots == nil) or (hazard_slots ~= math.floor(hazard_slots)) or
+		   (hazard_slots < 2) or (hazard_slots > 8) then
+			raise("hazard-slots must be an integer between 2 and 8, not " .. tostring(get_config("hazard-slots")))
+		end
+		add_defines_each_dependency("CHERIOT_HAZARD_SLOTS=" .. hazard_slots)
+
 		local loader = target:deps()['cheriot.loader'];
 
 		if board.stack_high_water_mark then
@@ -678,6 +739,65 @@ rule("cheriot.firmware")
 		mmio = format("__mmio_region_start = 0x%x;\n%s__mmio_region_end = 0x%x;\n__export_mem_heap_end = 0x%x;\n",
 			mmio_start, mmio, mmio_end, board.heap["end"])
 
+		-- Add any additional heap regions.  These must be above the main heap
+		-- and in ascending order, so that the range from the start of the
+		-- globals to the end of the last region, which the revoker sweeps,
+		-- covers all of them.
+		local heap_regions_end = board.heap["end"]
+		if board.heap_regions then
+			-- The revocation bitmap has one bit per eight-byte granule,
+			-- starting at the start of revokable memory.
+			local revokable_start = board.revokable_memory_start or board.instruction_memory.start
+			local revokable_end = nil
+			local shadow = board.devices.shadow
+			if shadow then
+				local shadow_end = shadow["end"] or (shadow.start + shadow.length)
+				revokable_end = revokable_start + (shadow_end - shadow.start) * 8 * 8
+			end
+			-- Claims and the owned-chunk index identify chunks by 16-bit
+			-- offsets, in eight-byte granules, from the start of the main
+			-- heap.  The main heap cannot start below the firmware image, so
+			-- measuring from there is conservative.
+			local lowest_heap_start = board.heap.start or board.instruction_memory.start
+			if (not board.heap.start) and board.data_memory then
+				lowest_heap_start = math.min(lowest_heap_start, board.data_memory.start)
+			end
+			local encodable_end = lowest_heap_start + 0xffff * 8
+			local heap_regions = ""
+			for i, region in ipairs(board.heap_regions) do
+				if not region.start or not region["end"] then
+					raise("Heap region " .. i .. " does not specify a start and an end")
+				end
+				if region.start < heap_regions_end then
+					raise(format("Heap region %d (0x%x) must be above the main heap and any previous heap regions (0x%x)", i, region.start, heap_regions_end))
+				end
+				if revokable_end and ((region.start < revokable_start) or (region["end"] > revokable_end)) then
+					raise(format("Heap region %d (0x%x-0x%x) is not covered by the revocation bitmap (0x%x-0x%x)", i, region.start, region["end"], revokable_start, revokable_end))
+				end
+				if region["end"] > encodable_end then
+					raise(format("Heap region %d (0x%x-0x%x) ends too far above the start of memory (0x%x) for the allocator to use", i, region.start, region["end"], lowest_heap_start))
+				end
+				-- The hardware revoker sweeps the whole range up to the end
+				-- of the last region, including the gap below this region,
+				-- so that gap must not contain any devices.
+				for name, range in table.orderpairs(board.devices) do
+					local stop = range["end"] or (range.start + range.length)
+					if (range.start < region.start) and (stop > heap_regions_end) then
+						raise(format("Device %s (0x%x-0x%x) is in the gap below heap region %d (0x%x-0x%x)", name, range.start, stop, i, heap_regions_end, region.start))
+					end
+				end
+				heap_regions_end = region["end"]
+				mmio = format("%s__export_mem_heap_region%d = 0x%x;\n__export_mem_heap_region%d_end = 0x%x;\n",
+					mmio, i, region.start, i, region["end"])
+				heap_regions = heap_regions .. format("CHERIOT_HEAP_REGION(heap_region%d, %d) ",
+					i, math.floor(region.preferred_max_allocation or 0))
+			end
+			-- The loader and allocator use this to grant and initialise each
+			-- region, and heap_address_is_valid uses it in every compartment.
+			add_defines_each_dependency("CHERIOT_HEAP_REGIONS=" .. heap_regions)
+		end
+		mmio = format("%s__heap_regions_end = 0x%x;\n", mmio, heap_regions_end)
+
 		local code_start = format("0x%x", board.instruction_memory.start);
 		-- Put the data either at the specified address if given, or directly after code
 		local data_start = board.data_memory and format("0x%x", board.data_memory.start) or '.';
@@ -998,8 +1118,8 @@ rule("cheriot.firmware")
 		local shared_objects = {
 			-- 32-bit counter for the hazard-pointer epoch.
 			allocator_epoch = 4,
-			-- Two hazard pointers per thread.
-			allocator_hazard_pointers = #(threads) * 8 * 2
+			-- hazard_slots hazard pointers per thread.
+			allocator_hazard_pointers = #(threads) * 8 * hazard_slots
 			}
 		visit_all_dependencies(function (target)
 			local globals = target:values("shared_objects")
@@ -1156,6 +1276,7 @@ function firmware(name)
 			target:set('cheriot.debug-name', "scheduler")
 			target:add('defines', "SCHEDULER_ACCOUNTING=" .. tostring(get_config("scheduler-accounting")))
 			target:add('defines', "SCHEDULER_MULTIWAITER=" .. tostring(get_config("scheduler-multiwaiter")))
+			target:add('defines', "SCHEDULER_TICKLESS=" .. tostring(get_config("scheduler-tickless")))
 		end)
 		add_files(path.join(coredir, "scheduler/main.cc"))
 
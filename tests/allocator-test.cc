@@ -322,6 +322,8 @@ namespace
 		TEST(memoryExhausted, "Failed to exhaust memory");
 		debug_log("Calling heap_render");
 		TEST_EQUAL(heap_render(), 0, "heap_render returned non-zero");
+		TEST_EQUAL(
+		  heap_snapshot_dump(), 0, "heap_snapshot_dump returned non-zero");
 		debug_log("Trying a non-blocking allocation");
 		// nullptr check because we explicitly want to check for OOM
 		TEST(heap_allocate(&noWait, MALLOC_CAPABILITY, BigAllocSize) == nullptr,
@@ -394,6 +396,367 @@ namespace
 		allocations.clear();
 	}
 
+	/**
+	 * Test that a thread blocked waiting for quota is woken when enough quota
+	 * is returned, but not by a free that leaves too little for it.
+	 */
+	void test_quota_waiter()
+	{
+		static cheriot::atomic<int> stage = 0;
+		static void                *objects[3];
+		constexpr size_t            BigSize = 400;
+		stage                               = 0;
+		objects[0] = heap_allocate(&noWait, SECOND_HEAP, BigSize);
+		objects[1] = heap_allocate(&noWait, SECOND_HEAP, BigSize);
+		objects[2] = heap_allocate(&noWait, SECOND_HEAP, 64);
+		for (auto object : objects)
+		{
+			TEST(__builtin_cheri_tag_get(object),
+			     "Failed to allocate for quota waiter test");
+		}
+		TEST(heap_quota_remaining(SECOND_HEAP) < BigSize,
+		     "Quota waiter test did not exhaust quota");
+		async([]() {
+			TEST(sleep(2) >= 0, "Failed to sleep");
+			// This returns too little quota for the waiter.
+			TEST_SUCCESS(heap_free(SECOND_HEAP, objects[2]));
+			TEST(heap_quota_remaining(SECOND_HEAP) < BigSize,
+			     "Small free returned too much quota");
+			stage = 1;
+			TEST(sleep(2) >= 0, "Failed to sleep");
+			stage = 2;
+			TEST_SUCCESS(heap_free(SECOND_HEAP, objects[0]));
+		});
+		Timeout t{AllocTimeout};
+		void   *ptr =
+		  heap_allocate(&t, SECOND_HEAP, BigSize, AllocateWaitQuotaExceeded);
+		TEST(__builtin_cheri_tag_get(ptr),
+		     "Blocking allocation waiting for quota failed: {}",
+		     ptr);
+		TEST_EQUAL(stage.load(),
+		           2,
+		           "Allocation waiting for quota returned before enough "
+		           "quota was freed");
+		TEST_SUCCESS(heap_free(SECOND_HEAP, ptr));
+		TEST_SUCCESS(heap_free(SECOND_HEAP, objects[1]));
+		TEST_EQUAL(heap_quota_remaining(SECOND_HEAP),
+		           SECOND_HEAP_QUOTA,
+		           "Quota waiter test leaked quota");
+	}
+
+	/**
+	 * Test that `heap_housekeeping` drains the quarantine and times out if
+	 * there is nothing to do.
+	 */
+	void test_housekeeping()
+	{
+		TEST_SUCCESS(heap_quarantine_empty());
+		TEST_EQUAL(heap_housekeeping(&noWait),
+		           -ETIMEDOUT,
+		           "Housekeeping with an empty quarantine did not time out");
+		void *ptr = heap_allocate(&noWait, SECOND_HEAP, 64);
+		TEST(__builtin_cheri_tag_get(ptr), "Failed to allocate 64 bytes");
+		TEST_SUCCESS(heap_free(SECOND_HEAP, ptr));
+		Timeout t{AllocTimeout};
+		TEST_SUCCESS(heap_housekeeping(&t));
+	}
+
+	/**
+	 * Test that `heap_stats` reports consistent values and counts failures.
+	 */
+	void test_stats()
+	{
+		HeapStats before;
+		HeapStats after;
+		TEST_SUCCESS(heap_stats(SECOND_HEAP, &before));
+		TEST_EQUAL(before.quotaRemaining,
+		           heap_quota_remaining(SECOND_HEAP),
+		           "heap_stats reported the wrong remaining quota");
+		TEST(before.quotaLowWater <= before.quotaRemaining,
+		     "Quota low-water mark {} is above the remaining quota {}",
+		     before.quotaLowWater,
+		     before.quotaRemaining);
+		TEST(before.largestFreeChunk <= before.freeBytes,
+		     "Largest free chunk {} is larger than the free space {}",
+		     before.largestFreeChunk,
+		     before.freeBytes);
+		TEST(before.inUseBytes > 0, "heap_stats reported no memory in use");
+
+		void *ptr = heap_allocate(&noWait, SECOND_HEAP, 512);
+		TEST(__builtin_cheri_tag_get(ptr), "Failed to allocate 512 bytes");
+		TEST(heap_allocate(&noWait, SECOND_HEAP, SECOND_HEAP_QUOTA) ==
+		       nullptr,
+		     "Allocation larger than the remaining quota succeeded");
+		TEST_SUCCESS(heap_stats(SECOND_HEAP, &after));
+		TEST_SUCCESS(heap_free(SECOND_HEAP, ptr));
+		TEST_EQUAL(after.failuresQuotaExceeded,
+		           before.failuresQuotaExceeded + 1,
+		           "Quota exceeded failure was not counted");
+		TEST(after.quotaLowWater <= SECOND_HEAP_QUOTA - 512,
+		     "Quota low-water mark {} does not reflect a 512-byte allocation",
+		     after.quotaLowWater);
+		TEST_EQUAL(heap_stats(SECOND_HEAP, nullptr),
+		           -EINVAL,
+		           "heap_stats accepted a null pointer");
+	}
+
+	/**
+	 * Test allocating and freeing objects in a pool, and that freed objects
+	 * are revoked before they are reused.
+	 */
+	void test_pool()
+	{
+		constexpr size_t ObjectSize  = 24;
+		constexpr size_t ObjectCount = 4;
+		HeapPool         pool =
+		  heap_pool_create(&noWait, SECOND_HEAP, ObjectSize, ObjectCount);
+		TEST(__builtin_cheri_tag_get(pool), "Failed to create pool");
+		TEST(heap_quota_remaining(SECOND_HEAP) <
+		       SECOND_HEAP_QUOTA - ObjectSize * ObjectCount,
+		     "Pool was not charged to the quota");
+
+		void *objects[ObjectCount];
+		for (auto &object : objects)
+		{
+			object = heap_pool_allocate(&noWait, pool);
+			TEST(Capability{object}.is_valid(), "Pool allocation failed");
+			TEST(Capability{object}.length() >= ObjectSize,
+			     "Pool object {} is too small",
+			     object);
+			memset(object, 0xff, ObjectSize);
+		}
+		TEST(!Capability{heap_pool_allocate(&noWait, pool)}.is_valid(),
+		     "Allocation from an exhausted pool succeeded");
+		TEST_EQUAL(heap_pool_free(pool, objects[1]),
+		           0,
+		           "Freeing pool object failed");
+		TEST_EQUAL(heap_pool_free(pool, objects[0]),
+		           0,
+		           "Freeing pool object failed");
+		TEST_EQUAL(heap_pool_free(pool, objects[0]),
+		           -EINVAL,
+		           "Double free of a pool object succeeded");
+		// Claims through a live object apply to the whole pool, even when
+		// the objects before it are waiting for revocation.
+		ssize_t claimSize = heap_claim(MALLOC_CAPABILITY, objects[2]);
+		TEST(claimSize >= static_cast<ssize_t>(ObjectSize * ObjectCount),
+		     "Claiming a pool object after a freed one failed: {}",
+		     claimSize);
+		TEST_SUCCESS(heap_free(MALLOC_CAPABILITY, objects[2]));
+#ifdef TEMPORAL_SAFETY
+		TEST(!Capability{objects[1]}.is_valid(),
+		     "Freed pool object {} is still valid",
+		     objects[1]);
+#endif
+
+		// Reuse requires revocation, so give the allocator time to wait.
+		Timeout t{AllocTimeout};
+		void   *reused = heap_pool_allocate(&t, pool);
+		TEST(Capability{reused}.is_valid(),
+		     "Pool allocation after free failed");
+		TEST(static_cast<uint8_t *>(reused)[0] == 0,
+		     "Reused pool object was not zeroed");
+		void *stack = &t;
+		TEST_EQUAL(heap_pool_free(pool, stack),
+		           -EINVAL,
+		           "Freeing a non-pool object succeeded");
+
+		TEST_SUCCESS(heap_pool_destroy(SECOND_HEAP, pool));
+		TEST(!Capability{heap_pool_allocate(&noWait, pool)}.is_valid(),
+		     "Allocation from a destroyed pool succeeded");
+		TEST_EQUAL(heap_quota_remaining(SECOND_HEAP),
+		           SECOND_HEAP_QUOTA,
+		           "Destroying a pool did not restore quota");
+
+		// A pool that is too large for its bounds to be exactly representable
+		// without extra alignment.  Allocating and freeing each object in
+		// turn walks through every object in the pool.
+		constexpr size_t LargeObjectSize  = 128;
+		constexpr size_t LargeObjectCount = 100;
+
+		pool = heap_pool_create(
+		  &noWait, MALLOC_CAPABILITY, LargeObjectSize, LargeObjectCount);
+		TEST(__builtin_cheri_tag_get(pool), "Failed to create large pool");
+		for (size_t i = 0; i < LargeObjectCount; i++)
+		{
+			Capability object = heap_pool_allocate(&noWait, pool);
+			TEST(object.is_valid(), "Large pool allocation {} failed", i);
+			TEST_EQUAL(object.length(),
+			           LargeObjectSize,
+			           "Large pool object has the wrong length");
+			TEST_EQUAL(heap_pool_free(pool, object),
+			           0,
+			           "Freeing large pool object {} failed",
+			           object);
+		}
+		TEST_SUCCESS(heap_pool_destroy(MALLOC_CAPABILITY, pool));
+	}
+
+	/**
+	 * Test that a pool object held by another thread's ephemeral claim is not
+	 * freed until the claim is dropped.
+	 */
+	void test_pool_hazards()
+	{
+		HeapPool pool = heap_pool_create(&noWait, SECOND_HEAP, 16, 2);
+		TEST(__builtin_cheri_tag_get(pool), "Failed to create pool");
+		void *object = heap_pool_allocate(&noWait, pool);
+		TEST(Capability{object}.is_valid(), "Pool allocation failed");
+		static cheriot::atomic<int> state = 0;
+		async([=]() {
+			Timeout t{1};
+			int     claimed = heap_claim_ephemeral(&t, object);
+			TEST(claimed == 0, "Heap claim failed: {}", claimed);
+			state = 1;
+			while (state.load() == 1) {}
+		});
+		int sleeps = 0;
+		while (state.load() != 1)
+		{
+			TEST(sleep(1) >= 0, "Failed to sleep");
+			TEST(sleeps++ < 100,
+			     "Background thread failed to establish hazards");
+		}
+		TEST_EQUAL(heap_pool_free(pool, object),
+		           -EBUSY,
+		           "Freeing a claimed pool object did not fail");
+		TEST(Capability{object}.is_valid(),
+		     "Pool object in hazard slot was freed: {}",
+		     object);
+		state = 2;
+		// The claim is dropped when the background thread returns.
+		sleeps = 0;
+		int ret;
+		while ((ret = heap_pool_free(pool, object)) == -EBUSY)
+		{
+			TEST(sleep(1) >= 0, "Failed to sleep");
+			TEST(sleeps++ < 100, "Pool object claim was never dropped");
+		}
+		TEST_EQUAL(ret, 0, "Freeing pool object after claim dropped failed");
+		TEST_SUCCESS(heap_pool_destroy(SECOND_HEAP, pool));
+		// Wait for the async lambda to be freed, as in `test_hazards`.
+		sleeps = 0;
+		while (heap_quota_remaining(MALLOC_CAPABILITY) < MALLOC_QUOTA &&
+		       heap_quota_remaining(MALLOC_CAPABILITY) > 0)
+		{
+			TEST(sleep(1) >= 0, "Failed to sleep");
+			TEST(sleeps++ < 100,
+			     "Sleeping for too long waiting for async lambda to be freed");
+		}
+	}
+
+	/**
+	 * Test growing and shrinking objects with `heap_resize`.
+	 */
+	void test_resize()
+	{
+		constexpr size_t SmallSize = 32;
+		constexpr size_t LargeSize = 256;
+		Timeout          t{AllocTimeout};
+		auto *small = static_cast<uint8_t *>(
+		  heap_allocate(&noWait, SECOND_HEAP, SmallSize));
+		void *next = heap_allocate(&noWait, SECOND_HEAP, LargeSize);
+		TEST(Capability{small}.is_valid() && Capability{next}.is_valid(),
+		     "Failed to allocate objects to resize");
+		memset(small, 0xa5, SmallSize);
+		// Free the object after `small` and let it leave quarantine, so that
+		// `small` can (usually) grow in place.
+		TEST_SUCCESS(heap_free(SECOND_HEAP, next));
+		TEST_SUCCESS(heap_quarantine_empty());
+
+		TEST(!Capability{heap_resize(&t, MALLOC_CAPABILITY, small, LargeSize)}
+		        .is_valid(),
+		     "Resizing with the wrong allocator capability succeeded");
+		TEST(!Capability{heap_resize(&t, SECOND_HEAP, small + 8, LargeSize)}
+		        .is_valid(),
+		     "Resizing with an interior pointer succeeded");
+
+		Capability grown{
+		  static_cast<uint8_t *>(heap_resize(&t, SECOND_HEAP, small, LargeSize))};
+		TEST(grown.is_valid(), "Growing {} failed", small);
+		TEST(grown.length() >= LargeSize,
+		     "Grown object {} is too small",
+		     grown);
+		for (size_t i = 0; i < LargeSize; i++)
+		{
+			TEST_EQUAL(grown[i],
+			           (i < SmallSize) ? 0xa5 : 0,
+			           "Wrong contents after growing object");
+		}
+		if (grown.base() == Capability{small}.base())
+		{
+			debug_log("Object grew in place");
+			TEST(Capability{small}.is_valid(),
+			     "Growing in place invalidated the old pointer");
+		}
+#ifdef TEMPORAL_SAFETY
+		else
+		{
+			TEST(!Capability{small}.is_valid(),
+			     "Moving object did not revoke the old pointer {}",
+			     small);
+		}
+#endif
+
+		Capability shrunk{
+		  static_cast<uint8_t *>(heap_resize(&t, SECOND_HEAP, grown, SmallSize))};
+		TEST(shrunk.is_valid(), "Shrinking {} failed", grown);
+		TEST_EQUAL(shrunk.length(), SmallSize, "Shrunk object has wrong size");
+		TEST_EQUAL(shrunk[0], 0xa5, "Wrong contents after shrinking object");
+#ifdef TEMPORAL_SAFETY
+		TEST(!grown.is_valid(),
+		     "Shrinking did not revoke the old pointer {}",
+		     grown);
+#endif
+		TEST_SUCCESS(heap_free(SECOND_HEAP, shrunk));
+		TEST_EQUAL(heap_quota_remaining(SECOND_HEAP),
+		           SECOND_HEAP_QUOTA,
+		           "Resizing leaked quota");
+	}
+
+	/**
+	 * Test aligned allocation, for alignments up to the page size, and that
+	 * the padding used to find an aligned address is not charged to the
+	 * quota.
+	 */
+	void test_aligned()
+	{
+		constexpr size_t ObjectSize = 64;
+		for (size_t alignment = 1; alignment <= 4096; alignment <<= 1)
+		{
+			size_t     quota = heap_quota_remaining(SECOND_HEAP);
+			Timeout    t{AllocTimeout};
+			Capability object{static_cast<uint8_t *>(heap_allocate_aligned(
+			  &t, SECOND_HEAP, ObjectSize, alignment))};
+			TEST(object.is_valid(),
+			     "Failed to allocate object with {}-byte alignment",
+			     alignment);
+			TEST((object.address() & (alignment - 1)) == 0,
+			     "Object {} is not {}-byte aligned",
+			     object,
+			     alignment);
+			TEST(object.length() >= ObjectSize,
+			     "Aligned object {} is too small",
+			     object);
+			TEST(object[ObjectSize - 1] == 0, "Aligned object is not zeroed");
+			// The object, its eight-byte header, and at most one eight-byte
+			// granule that is too small to split off.
+			size_t charged = quota - heap_quota_remaining(SECOND_HEAP);
+			TEST(charged <= ObjectSize + 16,
+			     "{}-byte aligned allocation was charged {} bytes of quota",
+			     alignment,
+			     charged);
+			TEST_SUCCESS(heap_free(SECOND_HEAP, object));
+		}
+		Timeout t{AllocTimeout};
+		TEST(!Capability{heap_allocate_aligned(&t, SECOND_HEAP, ObjectSize, 24)}
+		        .is_valid(),
+		     "Allocation with a non-power-of-two alignment succeeded");
+		TEST_EQUAL(heap_quota_remaining(SECOND_HEAP),
+		           SECOND_HEAP_QUOTA,
+		           "Aligned allocation leaked quota");
+	}
+
 	/**
 	 * This test aims to exercise as many possibilities in the allocator as
 	 * possible.
@@ -590,6 +953,117 @@ namespace
 		     quotaLeft);
 	}
 
+	/**
+	 * Test the batch allocation APIs.  Make sure that each object is
+	 * separately bounded and freeable, and that a batch that cannot be
+	 * satisfied leaves no objects allocated and the output array untouched.
+	 */
+	void test_batch()
+	{
+		constexpr size_t BatchSize = 8;
+		void            *objects[BatchSize];
+		TEST_SUCCESS(heap_allocate_batch(
+		  &noWait, SECOND_HEAP, 32, BatchSize, objects, AllocateWaitNone));
+		for (size_t i = 0; i < BatchSize; i++)
+		{
+			Capability object{objects[i]};
+			TEST(object.is_valid(), "Batch object {} is invalid", i);
+			TEST_EQUAL(object.length(), 32U, "Batch object has wrong length");
+			TEST(*static_cast<uint64_t *>(objects[i]) == 0,
+			     "Batch object {} is not zeroed",
+			     i);
+			for (size_t j = 0; j < i; j++)
+			{
+				TEST(object.base() != Capability{objects[j]}.base(),
+				     "Batch objects {} and {} overlap",
+				     i,
+				     j);
+			}
+		}
+		for (void *object : objects)
+		{
+			TEST_SUCCESS(heap_free(SECOND_HEAP, object));
+		}
+
+		size_t sizes[] = {8, 64, 16, 128};
+		TEST_SUCCESS(heap_allocate_batch_sizes(
+		  &noWait, SECOND_HEAP, sizes, std::size(sizes), objects));
+		for (size_t i = 0; i < std::size(sizes); i++)
+		{
+			TEST_EQUAL(Capability{objects[i]}.length(),
+			           sizes[i],
+			           "Mixed-size batch object has wrong length");
+			TEST_SUCCESS(heap_free(SECOND_HEAP, objects[i]));
+		}
+		TEST_EQUAL(heap_quota_remaining(SECOND_HEAP),
+		           SECOND_HEAP_QUOTA,
+		           "Batch allocation and free leaked quota");
+
+		// The last object does not fit in the remaining quota.  Make sure
+		// that the earlier ones are rolled back.
+		for (void *&object : objects)
+		{
+			object = nullptr;
+		}
+		size_t tooLarge[] = {256, 256, SECOND_HEAP_QUOTA};
+		TEST_EQUAL(
+		  heap_allocate_batch_sizes(
+		    &noWait, SECOND_HEAP, tooLarge, std::size(tooLarge), objects),
+		  -ENOMEM,
+		  "Over-quota batch allocation did not fail");
+		for (void *object : objects)
+		{
+			TEST(object == nullptr,
+			     "Failed batch allocation modified the output array");
+		}
+		TEST_EQUAL(heap_quota_remaining(SECOND_HEAP),
+		           SECOND_HEAP_QUOTA,
+		           "Failed batch allocation leaked quota");
+		TEST_EQUAL(heap_allocate_batch(&noWait,
+		                               SECOND_HEAP,
+		                               16,
+		                               std::numeric_limits<size_t>::max(),
+		                               objects),
+		           -EINVAL,
+		           "Overflowing batch allocation did not fail");
+	}
+
+	/**
+	 * Test heap_free_batch.  Make sure that it frees everything that it can
+	 * and reports the entries that it could not free.
+	 */
+	void test_free_batch()
+	{
+		constexpr size_t BatchSize = 8;
+		void            *objects[BatchSize + 2];
+		TEST_SUCCESS(heap_allocate_batch(
+		  &noWait, SECOND_HEAP, 16, BatchSize, objects, AllocateWaitNone));
+		// Null entries are skipped, entries that can't be freed with this
+		// capability are reported.
+		objects[BatchSize] = nullptr;
+		void *foreign = heap_allocate(&noWait, MALLOC_CAPABILITY, 16);
+		TEST(Capability{foreign}.is_valid(), "Failed to allocate 16 bytes");
+		objects[BatchSize + 1] = foreign;
+		TEST_EQUAL(heap_free_batch(SECOND_HEAP, objects, std::size(objects)),
+		           ssize_t(1) << (BatchSize + 1),
+		           "heap_free_batch returned the wrong failure bitmap");
+		TEST_EQUAL(heap_quota_remaining(SECOND_HEAP),
+		           SECOND_HEAP_QUOTA,
+		           "heap_free_batch did not restore quota");
+#ifdef TEMPORAL_SAFETY
+		for (size_t i = 0; i < BatchSize; i++)
+		{
+			TEST(!Capability{objects[i]}.is_valid(),
+			     "Object {} freed by heap_free_batch is still valid",
+			     i);
+		}
+#endif
+		TEST_SUCCESS(heap_free(MALLOC_CAPABILITY, foreign));
+		TEST_EQUAL(heap_free_batch(SECOND_HEAP, objects, HeapFreeBatchMax + 1),
+		           -EINVAL,
+		           "Oversized heap_free_batch did not fail");
+	}
+
 	void test_hazards()
 	{
 		int sleeps;
@@ -665,6 +1139,167 @@ namespace
 		debug_log("Hazard pointer tests done");
 	}
 
+	/**
+	 * Test the array and variadic forms of the ephemeral-claim API, which
+	 * claim up to one pointer per hazard slot.
+	 */
+	void test_hazards_array()
+	{
+		Timeout     t{10};
+		const void *objects[CHERIOT_HAZARD_SLOTS + 1];
+		for (auto &object : objects)
+		{
+			object = heap_allocate(&t, SECOND_HEAP, 16);
+			TEST(Capability{object}.is_valid(), "Failed to allocate object");
+		}
+		TEST_EQUAL(heap_claim_ephemeral_array(&t, objects, std::size(objects)),
+		           -EINVAL,
+		           "Claiming more pointers than hazard slots did not fail");
+		TEST_SUCCESS(
+		  heap_claim_ephemeral_array(&t, objects, CHERIOT_HAZARD_SLOTS));
+		TEST_SUCCESS(heap_claim_ephemeral_array(&t, objects, 0));
+#if CHERIOT_HAZARD_SLOTS >= 3
+		TEST_SUCCESS(
+		  heap_claim_ephemeral(&t, objects[0], objects[1], objects[2]));
+#endif
+		for (auto object : objects)
+		{
+			TEST_SUCCESS(heap_free(SECOND_HEAP, const_cast<void *>(object)));
+		}
+#ifdef TEMPORAL_SAFETY
+		// The first object is now invalid but still has a heap address, so it
+		// must be rejected.
+		TEST_EQUAL(heap_claim_ephemeral_array(&t, objects, 1),
+		           -EINVAL,
+		           "Claiming a freed pointer did not fail");
+#endif
+	}
+
+	/**
+	 * Test hazard pointers held by several threads at once.  Each thread-pool
+	 * thread claims two objects, one through an interior pointer, and these
+	 * are interleaved in address order with objects that are not claimed.
+	 * Freeing all of the objects must defer freeing exactly the claimed ones
+	 * until the claims are released.
+	 *
+	 * The test firmware has two thread-pool threads (thread IDs 2 and 3), with
+	 * priority decreasing as the thread ID increases.  A thread holding an
+	 * ephemeral claim cannot make a cross-compartment call (that would drop
+	 * the claim), so it spins and starves lower-priority threads.  Threads
+	 * therefore claim in descending order of thread ID, so that the
+	 * lowest-priority thread claims first.
+	 */
+	void test_hazards_many_threads()
+	{
+		constexpr size_t            ClaimingThreads = 2;
+		constexpr size_t            Objects         = 4 * ClaimingThreads;
+		static void                *objects[Objects];
+		static cheriot::atomic<int> claimed  = 0;
+		static cheriot::atomic<int> release  = 0;
+		static cheriot::atomic<int> finished = 0;
+		bool                        isClaimed[Objects] = {};
+		Timeout                     longTimeout{1000};
+		int                         sleeps;
+		claimed  = 0;
+		release  = 0;
+		finished = 0;
+		for (auto &object : objects)
+		{
+			object = heap_allocate(&longTimeout, SECOND_HEAP, 32);
+			TEST(__builtin_cheri_tag_get(object),
+			     "Failed to allocate 32 bytes");
+		}
+		for (size_t i = 0; i < ClaimingThreads; i++)
+		{
+			size_t first  = 2 * i;
+			size_t second = Objects - 1 - (2 * i);
+			isClaimed[first]  = true;
+			isClaimed[second] = true;
+			async([=]() {
+				Capability interior{objects[first]};
+				interior.address() += 8;
+				interior.bounds() = 8;
+				// Wait for the lower-priority threads to claim.
+				int turn  = int(ClaimingThreads + 1) - thread_id_get();
+				int waits = 0;
+				while (claimed.load() != turn)
+				{
+					TEST(sleep(1) >= 0, "Failed to sleep");
+					TEST(waits++ < 100, "Other threads failed to claim");
+				}
+				Timeout t{10};
+				int     ret =
+				  heap_claim_ephemeral(&t, interior.get(), objects[second]);
+				TEST(ret == 0, "Heap claim failed: {}", ret);
+				claimed++;
+				while (release.load() == 0) {}
+				finished++;
+			});
+		}
+		sleeps = 0;
+		while (claimed.load() != int(ClaimingThreads))
+		{
+			TEST(sleep(1) >= 0, "Failed to sleep");
+			TEST(sleeps++ < 100, "Background threads failed to claim");
+		}
+		for (auto object : objects)
+		{
+			TEST_EQUAL(heap_free(SECOND_HEAP, object), 0, "Free failed");
+		}
+		for (size_t i = 0; i < Objects; i++)
+		{
+			if (isClaimed[i])
+			{
+				TEST(Capability{objects[i]}.is_valid(),
+				     "Pointer {} in hazard slot was freed: {}",
+				     i,
+				     objects[i]);
+			}
+#ifdef TEMPORAL_SAFETY
+			else
+			{
+				TEST(!Capability{objects[i]}.is_valid(),
+				     "Unclaimed pointer {} was not freed: {}",
+				     i,
+				     objects[i]);
+			}
+#endif
+		}
+		release = 1;
+		sleeps  = 0;
+		while (finished.load() != int(ClaimingThreads))
+		{
+			TEST(sleep(1) >= 0, "Failed to sleep");
+			TEST(sleeps++ < 100, "Background threads failed to finish");
+		}
+		// Yield to allow the hazards to be dropped, then free something to
+		// make the allocator recheck the hazard quarantine.
+		TEST(sleep(1) >= 0, "Failed to yield to drop hazards");
+		TEST_SUCCESS(heap_free(SECOND_HEAP,
+		                       heap_allocate(&longTimeout, SECOND_HEAP, 16)));
+#ifdef TEMPORAL_SAFETY
+		for (size_t i = 0; i < Objects; i++)
+		{
+			TEST(!Capability{objects[i]}.is_valid(),
+			     "Pointer {} was not freed after its claim was released: {}",
+			     i,
+			     objects[i]);
+		}
+#endif
+		// Wait for the async lambdas to be freed, as in `test_hazards`.
+		sleeps = 0;
+		while (heap_quota_remaining(MALLOC_CAPABILITY) < MALLOC_QUOTA &&
+		       heap_quota_remaining(MALLOC_CAPABILITY) > 0)
+		{
+			TEST(sleep(1) >= 0, "Failed to sleep");
+			TEST(sleeps++ < 100,
+			     "Sleeping for too long waiting for async lambda to be freed");
+		}
+		TEST_EQUAL(heap_quota_remaining(SECOND_HEAP),
+		           SECOND_HEAP_QUOTA,
+		           "Hazard test leaked quota");
+	}
+
 	void test_large_token(size_t tokenSize)
 	{
 		void      *unsealedCapability;
@@ -818,6 +1453,126 @@ namespace
 		           "Invalid outparam path failed to restore quota");
 	}
 
+	/**
+	 * Test that a destroyed sealed object is revoked and that the memory
+	 * that replaces it, which may be the same object reused, is zeroed.
+	 */
+	void test_token_reuse()
+	{
+		auto sealingCapability = STATIC_SEALING_TYPE(sealingTest);
+		for (size_t i = 0; i < 4; i++)
+		{
+			Timeout    t{AllocTimeout};
+			void      *unsealedCapability;
+			Capability sealedPointer =
+			  token_sealed_unsealed_alloc(&t,
+			                              SECOND_HEAP,
+			                              sealingCapability,
+			                              32,
+			                              &unsealedCapability);
+			TEST(sealedPointer.is_valid(), "Failed to allocate sealed object");
+			auto *bytes = static_cast<uint8_t *>(unsealedCapability);
+			for (size_t j = 0; j < 32; j++)
+			{
+				TEST_EQUAL(bytes[j], 0, "Sealed object was not zeroed");
+			}
+			memset(bytes, 0xff, 32);
+			TEST_SUCCESS(
+			  token_obj_destroy(SECOND_HEAP, sealingCapability, sealedPointer));
+#ifdef TEMPORAL_SAFETY
+			TEST(!Capability{unsealedCapability}.is_valid(),
+			     "Destroyed sealed object {} is still valid",
+			     unsealedCapability);
+#endif
+		}
+		TEST_EQUAL(heap_quota_remaining(SECOND_HEAP),
+		           SECOND_HEAP_QUOTA,
+		           "Sealed object reuse leaked quota");
+	}
+
+#ifdef CHERIOT_HEAP_REGIONS
+	/**
+	 * Test an additional heap region that the board declares.  Allocations
+	 * of up to `preferredMaxAllocation` bytes should be placed in the region,
+	 * freed objects in it should be revoked, pointers stored in it should be
+	 * swept, and `heap_free_all` should find the objects that it holds.
+	 */
+	void test_heap_region(ptraddr_t start,
+	                      ptraddr_t end,
+	                      size_t    preferredMaxAllocation)
+	{
+		debug_log("Testing heap region {}--{}", start, end);
+		if (preferredMaxAllocation < sizeof(void *))
+		{
+			debug_log("Region has no preferred allocations, skipping");
+			return;
+		}
+		auto isInRegion = [&](Capability<void> object) {
+			return object.is_valid() && (object.base() >= start) &&
+			       (object.top() <= end);
+		};
+
+		Capability<void *> holder{static_cast<void **>(
+		  heap_allocate(&noWait, MALLOC_CAPABILITY, preferredMaxAllocation))};
+		TEST(isInRegion(holder),
+		     "Small allocation {} was not placed in the heap region",
+		     holder);
+		TEST(heap_address_is_valid(holder),
+		     "Heap region object {} reported as not heap address",
+		     holder);
+		Capability<void> object =
+		  heap_allocate(&noWait, MALLOC_CAPABILITY, preferredMaxAllocation);
+		TEST(isInRegion(object),
+		     "Small allocation {} was not placed in the heap region",
+		     object);
+		*holder = object;
+		TEST_SUCCESS(heap_free(MALLOC_CAPABILITY, object));
+		TEST_SUCCESS(heap_quarantine_empty());
+#	if __has_builtin(__builtin_cheri_tag_get_temporal)
+		TEST(!__builtin_cheri_tag_get_temporal(*holder),
+		     "Revoker failed to sweep heap region");
+#	endif
+		TEST_SUCCESS(heap_free(MALLOC_CAPABILITY, holder));
+
+		void *objects[4];
+		for (auto &allocation : objects)
+		{
+			allocation =
+			  heap_allocate(&noWait, SECOND_HEAP, preferredMaxAllocation);
+			TEST(isInRegion(allocation),
+			     "Small allocation {} was not placed in the heap region",
+			     allocation);
+		}
+		TEST(heap_free_all(SECOND_HEAP) >=
+		       static_cast<ssize_t>(preferredMaxAllocation * 4),
+		     "heap_free_all did not free objects in the heap region");
+		TEST_EQUAL(heap_quota_remaining(SECOND_HEAP),
+		           SECOND_HEAP_QUOTA,
+		           "heap_free_all did not restore quota");
+#	ifdef TEMPORAL_SAFETY
+		for (auto &allocation : objects)
+		{
+			TEST(!Capability{allocation}.is_valid(),
+			     "Object {} in heap region was not freed",
+			     allocation);
+		}
+#	endif
+	}
+
+	/**
+	 * Test each additional heap region that the board declares.
+	 */
+	void test_heap_regions()
+	{
+#	define CHERIOT_HEAP_REGION(name, preferredMaxAllocation)                   \
+		test_heap_region(LA_ABS(__export_mem_##name),                          \
+		                 LA_ABS(__export_mem_##name##_end),                    \
+		                 preferredMaxAllocation);
+		CHERIOT_HEAP_REGIONS
+#	undef CHERIOT_HEAP_REGION
+	}
+#endif
+
 } // namespace
 
 /**
@@ -830,7 +1585,14 @@ int test_allocator()
 	const ptraddr_t HeapStart = LA_ABS(__export_mem_heap);
 	const ptraddr_t HeapEnd   = LA_ABS(__export_mem_heap_end);
 
-	const size_t HeapSize = HeapEnd - HeapStart;
+	size_t HeapSize = HeapEnd - HeapStart;
+#ifdef CHERIOT_HEAP_REGIONS
+#	define CHERIOT_HEAP_REGION(name, preferredMaxAllocation)                   \
+		HeapSize +=                                                            \
+		  LA_ABS(__export_mem_##name##_end) - LA_ABS(__export_mem_##name);
+	CHERIOT_HEAP_REGIONS
+#	undef CHERIOT_HEAP_REGION
+#endif
 	debug_log("Heap size is {} bytes", HeapSize);
 
 	test_preflight();
@@ -852,11 +1614,19 @@ int test_allocator()
 	}
 
 	test_token();
+	test_token_reuse();
 	test_hazards();
+	test_hazards_array();
+	test_hazards_many_threads();
 
 	// Make sure that free works only on memory owned by the caller.
 	Timeout t{5};
 	test_free_all();
+	test_batch();
+	test_free_batch();
+#ifdef CHERIOT_HEAP_REGIONS
+	test_heap_regions();
+#endif
 	void *ptr = heap_allocate(&t, STATIC_SEALED_VALUE(secondHeap), 32);
 	TEST(__builtin_cheri_tag_get(ptr), "Failed to allocate 32 bytes");
 	TEST(heap_address_is_valid(ptr) == true,
@@ -898,6 +1668,13 @@ int test_allocator()
 
 	test_blocking_allocator(HeapSize);
 	TEST_SUCCESS(heap_quarantine_empty());
+	test_quota_waiter();
+	test_housekeeping();
+	test_stats();
+	test_pool();
+	test_pool_hazards();
+	test_resize();
+	test_aligned();
 	test_revoke(HeapSize);
 	test_fuzz();
 	allocations.clear();
@@ -56,6 +56,27 @@ int test_futex()
 		     "futex_timed_wait timed out but elapsed ticks {} too small",
 		     t.elapsed);
 	}
+	debug_log("Calling futex with a precise timeout");
+	{
+		// Half a tick, which a timeout in ticks cannot express.
+		Timeout t = Timeout::from_timer_cycles(TIMERCYCLES_PER_TICK / 2);
+
+		SystickReturn start = thread_systemtick_get();
+		int           err   = futex_timed_wait(&t, &futex, 1);
+		SystickReturn end   = thread_systemtick_get();
+		TEST(err == -ETIMEDOUT,
+		     "futex_timed_wait returned {}, expected {}",
+		     err,
+		     -ETIMEDOUT);
+		TEST(!t.may_block(),
+		     "Precise timeout has {} cycles ({} ticks) left after timing out",
+		     t.remainingCycles,
+		     t.remaining);
+		// A wait of half a tick can cross at most one tick boundary.
+		TEST(end.lo - start.lo <= 1,
+		     "futex_timed_wait for half a tick took {} ticks",
+		     end.lo - start.lo);
+	}
 	Timeout t{3};
 	auto    err = futex_timed_wait(&t, &futex, 0);
 	TEST(err == 0, "futex_timed_wait returned {}, expected {}", err, 0);
@@ -5,8 +5,10 @@
 #include "tests.hh"
 #include <compartment-macros.h>
 #include <ds/pointer.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <thread.h>
 #include <timeout.h>
 
 using namespace CHERI;
@@ -25,6 +27,8 @@ namespace
 	 *   would still be `UINT32_MAX` after a call to `elapse`.
 	 * - An unlimited timeout is really unlimited, i.e., a call to `elapse` does
 	 *   not modify its `remaining` value, which blocks.
+	 * - A precise timeout rounds its remaining time up to whole ticks and
+	 *   `elapse` reduces its remaining cycles by the elapsed ticks.
 	 */
 	void check_timeouts()
 	{
@@ -55,6 +59,19 @@ namespace
 		     "`elapse` alters the remaining value of an unlimited timeout.");
 		// Ensure that an unlimited timeout blocks.
 		TEST(t.may_block(), "An unlimited timeout should block.");
+
+		// Create a precise timeout of just over one tick.
+		t = Timeout::from_timer_cycles(TIMERCYCLES_PER_TICK + 1);
+		TEST_EQUAL(t.remaining,
+		           2U,
+		           "A precise timeout should round up to whole ticks");
+		t.elapse(1);
+		TEST_EQUAL(t.remainingCycles,
+		           1U,
+		           "`elapse` should reduce the cycles in a precise timeout");
+		TEST(t.may_block(), "A partly elapsed precise timeout should block.");
+		t.elapse(1);
+		TEST(!t.may_block(), "An elapsed precise timeout should not block.");
 	}
 
 	/**
@@ -281,6 +298,57 @@ namespace
 		     "CILS failed to store stack pointer");
 	}
 
+	/**
+	 * Test absolute-deadline sleeps and the periodic timer helper.
+	 *
+	 * This test checks the following:
+	 *
+	 * - `thread_sleep_until` fails without sleeping for a deadline in the
+	 *   past.
+	 * - `PeriodicTimer::wait` returns at exact multiples of the period after
+	 *   construction and reports no overruns if the work finishes in time.
+	 * - If the work overruns, `wait` skips the periods that have started,
+	 *   reports how many there were, and stays in phase.
+	 */
+	void check_periodic()
+	{
+		debug_log("Test periodic sleeps.");
+
+		TEST_EQUAL(thread_sleep_until(0),
+		           -ETIMEDOUT,
+		           "thread_sleep_until a deadline in the past should fail");
+
+		constexpr uint64_t Period = TIMERCYCLES_PER_TICK / 2;
+		PeriodicTimer      periodic{Period};
+		uint64_t           release = periodic.next_release();
+		for (int i = 0; i < 4; i++)
+		{
+			TEST_EQUAL(periodic.wait(), 0U, "Periodic wait reported overrun");
+			uint64_t now = thread_timer_get();
+			TEST(now >= release,
+			     "Periodic wait returned at {}, before release at {}",
+			     now,
+			     release);
+			release += Period;
+			TEST_EQUAL(periodic.next_release(),
+			           release,
+			           "Periodic timer drifted from multiples of the period");
+		}
+
+		// Overrun by two and a half periods.
+		while (thread_timer_get() < release + 2 * Period + Period / 2) {}
+		TEST_EQUAL(periodic.wait(), 3U, "Periodic wait missed overruns");
+		release += 4 * Period;
+		TEST_EQUAL(periodic.next_release(),
+		           release,
+		           "Periodic timer lost phase after an overrun");
+
+		// A zero period is clamped, rather than dividing by zero on overrun.
+		auto zeroPeriod = PeriodicTimer::from_microseconds(0);
+		while (thread_timer_get() <= zeroPeriod.next_release()) {}
+		TEST(zeroPeriod.wait() > 0, "Zero-period timer did not overrun");
+	}
+
 	const char *testString = "Hello world";
 
 } // namespace
@@ -352,6 +420,7 @@ int test_misc()
 	check_capability_set_inexact_at_most();
 	check_sealed_scoping();
 	check_cils();
+	check_periodic();
 
 	debug_log("Testing shared objects.");
 	check_shared_object("exampleK",
@@ -19,6 +19,7 @@ __cheri_compartment("stack_test") int test_stack();
 __cheri_compartment("compartment_calls_test") int test_compartment_call();
 __cheri_compartment("check_pointer_test") int test_check_pointer();
 __cheri_compartment("misc_test") int test_misc();
+__cheri_compartment("tickless_test") int test_tickless();
 __cheri_compartment("static_sealing_test") int test_static_sealing();
 __cheri_compartment("stdio_test") int test_stdio();
 __cheri_compartment("debug_test") int test_debug_cxx();
@@ -0,0 +1,88 @@
+// Copyright Microsoft and CHERIoT Contributors.
+// SPDX-License-Identifier: MIT
+
+#define TEST_NAME "Tickless"
+#include "tests.hh"
+#include <thread.h>
+#include <timeout.h>
+
+namespace
+{
+	/// Is the scheduler built for tickless idle?
+	constexpr bool Tickless = SCHEDULER_TICKLESS;
+
+	/// The number of sleeps in each workload.
+	constexpr uint32_t Iterations = 4;
+
+	/// The length of each sleep, in ticks.
+	constexpr uint32_t SleepTicks = 8;
+
+	/**
+	 * Returns the number of ticks since boot.
+	 */
+	uint64_t ticks_since_boot()
+	{
+		SystickReturn ticks = thread_systemtick_get();
+		return (static_cast<uint64_t>(ticks.hi) << 32) | ticks.lo;
+	}
+
+	/**
+	 * Sleep repeatedly with the given flags, while no other thread is
+	 * runnable, and report how many timer interrupts were avoided compared to
+	 * taking one on every tick.  If `expectFullSleep` is true, check that
+	 * each sleep lasted for the requested time and needed only a timer
+	 * interrupt or two to wake.
+	 */
+	void idle_workload(const char *name, uint32_t flags, bool expectFullSleep)
+	{
+		uint64_t startTicks      = ticks_since_boot();
+		uint64_t startInterrupts = thread_timer_interrupt_count();
+		for (uint32_t i = 0; i < Iterations; i++)
+		{
+			Timeout t{SleepTicks};
+			TEST_SUCCESS(thread_sleep(&t, flags));
+			TEST(!expectFullSleep || (t.elapsed >= SleepTicks),
+			     "{} sleep woke after {} ticks, expected {}",
+			     name,
+			     t.elapsed,
+			     SleepTicks);
+		}
+		uint64_t ticks      = ticks_since_boot() - startTicks;
+		uint64_t interrupts = thread_timer_interrupt_count() - startInterrupts;
+		debug_log("{} sleeps: {} ticks elapsed, {} timer interrupts, {} "
+		          "avoided",
+		          name,
+		          ticks,
+		          interrupts,
+		          ticks > interrupts ? ticks - interrupts : 0);
+		if (expectFullSleep)
+		{
+			TEST(ticks >= Iterations * SleepTicks,
+			     "{} sleeps took {} ticks, expected at least {}",
+			     name,
+			     ticks,
+			     Iterations * SleepTicks);
+			// Each sleep should be woken by a single timer interrupt at its
+			// deadline.  Allow for one more, for timeouts in other threads.
+			TEST(interrupts <= 2 * Iterations,
+			     "{} sleeps took {} timer interrupts, expected at most {}",
+			     name,
+			     interrupts,
+			     2 * Iterations);
+		}
+	}
+} // namespace
+
+/**
+ * Test that the scheduler does not take a timer interrupt on every tick when
+ * the system is idle.  Sleeps that do not permit an early wake always leave
+ * the system idle until their deadline.  Yielding sleeps do so only in
+ * tickless mode, otherwise they are woken early because no other thread is
+ * runnable.
+ */
+int test_tickless()
+{
+	idle_workload("Non-yielding", ThreadSleepNoEarlyWake, true);
+	idle_workload("Yielding", 0, Tickless);
+	return 0;
+}
@@ -86,6 +86,9 @@ test("misc")
     on_load(function(target)
         target:values_set("shared_objects", { exampleK = 1024, test_word = 4 }, {expand = false})
     end)
+-- Test that idle systems avoid timer interrupts
+test("tickless")
+    add_defines("SCHEDULER_TICKLESS=" .. tostring(get_config("scheduler-tickless")))
 test("unwind_cleanup")
     add_deps("unwind_error_handler")
 
@@ -122,6 +125,7 @@ firmware("test-suite")
     add_deps("compartment_calls_test", "compartment_calls_inner")
     add_deps("check_pointer_test")
     add_deps("misc_test")
+    add_deps("tickless_test")
     add_deps("stdio_test")
     add_deps("debug_test")
     add_deps("unwind_cleanup_test")